@@ -57,10 +57,15 @@ extern RC shutdownIndexManager() {
 
 // Function to create a new B+-tree
 extern RC createBtree(char *idxId, DataType keyType, int n) {
+    return createBtreeWithPageSize(idxId, keyType, n, PAGE_SIZE);
+}
+
+// Function to create a new B+-tree whose index file has pages of pageSize bytes
+extern RC createBtreeWithPageSize(char *idxId, DataType keyType, int n, int pageSize) {
     SM_FileHandle fh;  // File handle for managing the page file for the B+-tree
 
-    // Create a new page file with the specified index ID (idxId)
-    if (createPageFile(idxId) != RC_OK)
+    // Create a new page file with the specified index ID (idxId) and page size
+    if (createPageFileWithPageSize(idxId, pageSize) != RC_OK)
         return RC_IM_KEY_NOT_FOUND;    // Return error if page file creation fails
 
     // Open the newly created page file and attach it to the file handle (fh)
@@ -1,122 +1,1932 @@
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 
 #define RC_ERROR 200
 #define RC_PINNED_PAGES_IN_BUFFER 201
 
+// Size of the huge pages the frame arena is rounded up to when BM_PoolOptions.hugePages is set
+#define BM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// The page table is split into 2^BM_PARTITION_BITS partitions by page number hash, each with its own lock
+#define BM_PARTITION_BITS 6
+#define BM_PARTITIONS (1 << BM_PARTITION_BITS)
+
+// The background writer runs a round at least this often, and whenever a miss had to write back a dirty victim
+#define BM_WRITER_INTERVAL_MS 50
+
+// Percentage of dirty frames above which unpinning threads wait for the writer, if BM_PoolOptions leaves it 0
+#define BM_DIRTY_HIGH_WATER 75
+
+// A flush writes at most this many adjacent pages with one call; their frames stay latched until it returns
+#define BM_FLUSH_RUN_PAGES 32
+
+// Hits and unpins wait in a ring of this many events (a power of two) until they are applied to the replacement
+// bookkeeping. Once the ring is half full the next thread that finds poolLock free applies them
+#define BM_EVENT_RING 1024
+
+// Ends of a doubly linked list of frames (linked through listPrev/listNext) or ARC ghosts, -1 if it is empty
+typedef struct FrameList
+{
+    int newest;
+    int oldest;
+    int size;
+} FrameList;
+
+// Open addressing hash table from page numbers to ints (LRU-K history entries, ARC ghosts)
+typedef struct PageIndex
+{
+    PageNumber *pages;  // Page number of each slot, NO_PAGE for an empty slot
+    int *values;
+    int mask;           // Number of slots - 1 (the number of slots is a power of two)
+} PageIndex;
+
+// A page recently evicted under ARC: only its number is kept, in ghost list B1 or B2
+typedef struct ArcGhost
+{
+    PageNumber pageNum;
+    FrameList *list;    // arcB1 or arcB2, NULL for an unused node (unused nodes are chained through next)
+    int prev;           // Neighbours in the list: towards the newest and the oldest end, -1 at the ends
+    int next;
+} ArcGhost;
+
+// Concurrency: a frame is pinned by raising fixCount under the lock of the partition mapping its page, and a frame
+// is only taken for another page while fixCount is 0 under that lock, so a pinned frame keeps its page.
+// poolLock protects the replacement bookkeeping (lists, heaps, buckets, the CLOCK hand) and the choice of victims.
+// Hits and unpins do not take it: they log an event in a ring, which is applied under poolLock in the order the
+// events were logged before a victim is chosen (see logEvent).
+// A thread holding poolLock may take a partition lock, never the other way round.
+// The frame latch is held exclusively while the frame's page is written back for eviction or read in (busy is
+// set meanwhile), otherwise by the clients that pin the page with BM_LATCH_SHARED or BM_LATCH_EXCLUSIVE.
+// fixCount, isDirty, busy and referenced are accessed atomically, pageNum atomically where no partition lock is held
 typedef struct PageFrame 
 {
     SM_PageHandle data; // Pointer to page data
     PageNumber pageNum; // Page number
     bool isDirty;       // Flag indicating if the page is dirty
     int fixCount;       // Number of clients using this page
-    int lastUsed;       // Timestamp of last use (for FIFO)
-    int lruCount;       // Counter for LRU strategy
+    bool busy;          // The frame is being evicted or loaded; pins of it wait for the latch
+    pthread_rwlock_t latch;
+    FrameList *list;    // FIFO, LRU and ARC strategies: replacement list holding the frame, NULL if none
+    int listPrev;       // Neighbours in the list: towards the newest and the oldest end, -1 at the ends
+    int listNext;
+    bool referenced;    // Reference bit for CLOCK strategy, set on every pin
+    int lfuBucket;      // LFU strategy: frequency bucket of the page, -1 if the frame is in none
+    int lfuPrev;        // LFU strategy: neighbours in the frame list of the bucket, -1 at the ends
+    int lfuNext;
+    int lrukLast;       // LRU-K strategy: time of the last pin, 0 if never pinned
+    int heapPos;        // LRU-K strategy: position in the victim heap, -1 while pinned or empty
+    bool arcToT2;       // ARC strategy: the page being loaded into the frame goes to T2
+    bool arcNoGhost;    // ARC strategy: the page being evicted from the frame leaves no ghost
+    bool arcReferenced; // ARC strategy: the page was pinned since it was loaded (a prefetched page was not)
+    unsigned arcLastRef;    // ARC strategy: arcClock at the last reference of the page
+    bool freeListed;    // The frame is on the free frame stack
 } PageFrame;
 
-// Define the structure for management information
-typedef struct MgmtInfo {
-    PageFrame *frames;  // Array of page frames
-    int readIO;         // Counter for read I/O operations
-    int writeIO;        // Counter for write I/O operations
-    int cacheHits;      // Counter for cache hits
-} MgmtInfo;
+// One partition of the page table: an open addressing hash table from page numbers to frames.
+// Aligned to a cache line so the locks of neighbouring partitions do not share one
+typedef struct PagePartition
+{
+    pthread_mutex_t lock;
+    int *slots;         // Frame index of each cached page, -1 for an empty slot
+    int mask;           // Number of slots - 1 (the number of slots is a power of two)
+    int count;          // Number of cached pages in the partition
+} __attribute__((aligned(64))) PagePartition;
+
+// A frequency bucket of the LFU strategy: the cached pages pinned freq times (since the last aging).
+// Buckets form a list in increasing frequency order, each holds a list of frames, most recently pinned first
+typedef struct LFUBucket
+{
+    int freq;           // Pin count of the pages in the bucket
+    int prev;           // Neighbouring buckets, -1 at the ends
+    int next;
+    int head;           // Most and least recently pinned frame of the bucket
+    int tail;
+} LFUBucket;
+
+// A hit or unpin waiting in the event ring
+typedef struct FrameEvent
+{
+    unsigned seq;       // Position of the event in the ring + 1 once it is written
+    int kind;           // EVENT_HIT, EVENT_SHARED_HIT or EVENT_RELEASE
+    int frameNum;
+    PageNumber pageNum; // Page of the frame when the event was logged, the event is dropped if the frame lost it
+} FrameEvent;
+
+// Define the structure for management information
+typedef struct MgmtInfo {
+    PageFrame *frames;  // Array of page frames
+    char *arena;        // Memory of all frames: frame i holds its page at arena + i * pageSize
+    size_t arenaSize;   // Bytes mapped for the arena
+    int readIO;         // Counter for read I/O operations
+    int writeIO;        // Counter for write I/O operations
+    int cacheHits;      // Counter for pins of pages already in the pool
+    int pinRequests;    // Counter for all pins
+    SM_FileHandle fh;   // The page file, open from initBufferPool until shutdownBufferPool
+    int syncPolicy;     // Storage manager sync policy (SM_SYNC_*) for written pages
+    pthread_mutex_t poolLock;   // Protects the replacement bookkeeping (see PageFrame)
+    pthread_mutex_t fileLock;   // Serialises growing the page file
+    PagePartition *partitions;  // The page table, BM_PARTITIONS partitions
+    int *freeFrames;    // Stack of empty frames, taken before the strategy is asked for a victim
+    int numFreeFrames;
+    bool loggedHits;    // Hits are logged for the replacement bookkeeping (all strategies but FIFO and CLOCK)
+    FrameEvent *events; // The event ring, BM_EVENT_RING events, NULL for FIFO and CLOCK
+    unsigned eventTail; // Position of the next event logged, taken atomically
+    unsigned eventHead; // Position of the next event applied, advanced under poolLock
+    int listMode;       // LIST_NONE, LIST_FIFO or LIST_LRU
+    FrameList list;     // Replacement list of the FIFO and LRU strategies
+    int clockHand;      // Next frame the CLOCK strategy looks at
+    LFUBucket *lfuBuckets;  // LFU strategy: bucket nodes (one per frame and a spare), NULL for other strategies
+    int lfuFirst;       // Bucket with the lowest frequency, -1 if no page is cached
+    int lfuFreeBucket;  // First unused bucket node, unused nodes are chained through next
+    int lfuAgingInterval;   // Pins between two agings (all frequencies are halved), 0 for no aging
+    int lfuPins;        // Pins since the last aging
+    int lrukK;          // LRU-K strategy: number of references kept per page, 0 for other strategies
+    int lrukCorrelatedPeriod;   // Pins after a reference that belong to the same (correlated) reference
+    int lrukClock;      // Time: number of pins so far
+    int *lrukHist;      // Times of the last K uncorrelated references of each frame (K ints per frame, 0 for none)
+    int *lrukHeap;      // Unpinned cached frames, the one with the oldest K-th reference first
+    int lrukHeapSize;
+    PageNumber *lrukHistoryPage;  // History of evicted pages (a ring, oldest entry replaced first), NO_PAGE if unused
+    int *lrukHistoryLast;   // Time of the last pin of each history entry
+    int *lrukHistoryHist;   // References of each history entry (K ints per entry)
+    int lrukHistorySize;    // Number of history entries
+    int lrukHistoryNext;    // Entry the next evicted page is written to
+    PageIndex lrukIndex;    // History entry of each page number in the history
+    FrameList arcT1;    // ARC strategy: cached pages pinned once since they were loaded
+    FrameList arcT2;    // ARC strategy: cached pages pinned more than once, or loaded again while remembered as ghost
+    FrameList arcB1;    // ARC strategy: ghosts of pages evicted from T1 and T2
+    FrameList arcB2;
+    ArcGhost *arcGhosts;    // ARC strategy: ghost nodes (one per frame), NULL for other strategies
+    int arcFreeGhost;   // First unused ghost node
+    PageIndex arcGhostIndex;    // Ghost node of each page number in B1 or B2
+    int arcTarget;      // p: the size T1 is adapted towards
+    bool arcFromB2;     // The page being loaded was a ghost in B2
+    bool arcToT2;       // The page being loaded goes to T2
+    bool arcNoGhost;    // The next page evicted from T1 leaves no ghost
+    unsigned arcClock;  // Time: number of references of cached pages so far
+    int numDirty;       // Number of dirty frames
+    bool hasWriter;     // A background writer thread keeps cold frames clean (BM_PoolOptions.cleanFrames)
+    pthread_t writer;
+    pthread_mutex_t writerLock; // Protects writerStop, writerWake, writerStarted and writerRounds
+    pthread_cond_t writerCond;  // Wakes the writer before its interval is up
+    pthread_cond_t writerDone;  // Signalled whenever the writer finishes a round
+    bool writerStop;    // shutdownBufferPool asks the writer to end
+    bool writerWake;    // A round is asked for
+    unsigned writerStarted; // Rounds started so far
+    unsigned writerRounds;  // Rounds finished so far
+    int cleanTarget;    // Frames at the victim end of the strategy the writer keeps clean
+    int dirtyHighWater; // Dirty frames above which unpinning threads wait for a round of the writer
+} MgmtInfo;
+
+// Atomic accessors of the frame fields shared between threads
+#define FIX_COUNT(frame) __atomic_load_n(&(frame)->fixCount, __ATOMIC_ACQUIRE)
+#define IS_BUSY(frame) __atomic_load_n(&(frame)->busy, __ATOMIC_ACQUIRE)
+#define SET_BUSY(frame, value) __atomic_store_n(&(frame)->busy, (value), __ATOMIC_RELEASE)
+#define IS_DIRTY(frame) __atomic_load_n(&(frame)->isDirty, __ATOMIC_RELAXED)
+#define PAGE_NUM(frame) __atomic_load_n(&(frame)->pageNum, __ATOMIC_RELAXED)
+#define SET_PAGE_NUM(frame, value) __atomic_store_n(&(frame)->pageNum, (value), __ATOMIC_RELAXED)
+#define COUNT(counter) __atomic_fetch_add(&(counter), 1, __ATOMIC_RELAXED)
+
+// Set or clear the dirty flag of frame, keeping count of the dirty frames
+static void setDirty(MgmtInfo *mgmtData, PageFrame *frame, bool dirty)
+{
+    if (__atomic_exchange_n(&frame->isDirty, dirty, __ATOMIC_RELAXED) != dirty)
+        __atomic_fetch_add(&mgmtData->numDirty, dirty ? 1 : -1, __ATOMIC_RELAXED);
+}
+
+// Slot where the search for pageNum starts (Fibonacci hashing spreads adjacent page numbers)
+static int hashPage(PageNumber pageNum, int mask)
+{
+    unsigned hash = (unsigned)pageNum * 2654435769u;
+    return (int)(hash ^ (hash >> 16)) & mask;
+}
+
+// Partition of the page table holding pageNum: the top bits of the Fibonacci hash, the slot inside takes the low bits
+static PagePartition *partitionOf(MgmtInfo *mgmtData, PageNumber pageNum)
+{
+    unsigned hash = (unsigned)pageNum * 2654435769u;
+    return &mgmtData->partitions[hash >> (32 - BM_PARTITION_BITS)];
+}
+
+// Frame index holding pageNum in partition part, -1 if the page is not in the pool. The caller holds the partition lock
+static int partitionFind(MgmtInfo *mgmtData, PagePartition *part, PageNumber pageNum)
+{
+    for (int slot = hashPage(pageNum, part->mask); part->slots[slot] != -1; slot = (slot + 1) & part->mask)
+    {
+        if (mgmtData->frames[part->slots[slot]].pageNum == pageNum)
+            return part->slots[slot];
+    }
+    return -1;
+}
+
+static void partitionPut(MgmtInfo *mgmtData, int *slots, int mask, int frameNum)
+{
+    int slot = hashPage(mgmtData->frames[frameNum].pageNum, mask);
+    while (slots[slot] != -1)
+        slot = (slot + 1) & mask;
+    slots[slot] = frameNum;
+}
+
+// Record that frame frameNum now holds the page in its pageNum. A partition is kept at most half full
+// and doubles when it would fill up more. Returns false if out of memory. The caller holds the partition lock
+static bool insertFrame(MgmtInfo *mgmtData, PagePartition *part, int frameNum)
+{
+    if (2 * (part->count + 1) > part->mask + 1)
+    {
+        int size = 2 * (part->mask + 1);
+        int *slots = malloc(sizeof(int) * size);
+        if (slots == NULL)
+            return false;
+        for (int i = 0; i < size; i++)
+            slots[i] = -1;
+        for (int i = 0; i <= part->mask; i++)
+        {
+            if (part->slots[i] != -1)
+                partitionPut(mgmtData, slots, size - 1, part->slots[i]);
+        }
+        free(part->slots);
+        part->slots = slots;
+        part->mask = size - 1;
+    }
+    partitionPut(mgmtData, part->slots, part->mask, frameNum);
+    part->count++;
+    return true;
+}
+
+// Forget the page held by frame frameNum. The entries after the removed one that would no longer
+// be found from their home slot are moved back into the gap, so no deleted markers are needed.
+// The caller holds the partition lock
+static void removeFrame(MgmtInfo *mgmtData, PagePartition *part, int frameNum)
+{
+    int mask = part->mask;
+    int slot = hashPage(mgmtData->frames[frameNum].pageNum, mask);
+    while (part->slots[slot] != frameNum)
+    {
+        if (part->slots[slot] == -1)
+            return;
+        slot = (slot + 1) & mask;
+    }
+
+    int gap = slot;
+    for (slot = (gap + 1) & mask; part->slots[slot] != -1; slot = (slot + 1) & mask)
+    {
+        int home = hashPage(mgmtData->frames[part->slots[slot]].pageNum, mask);
+        // The entry may move to the gap if its home slot is not between the gap and its current slot
+        if (((slot - home) & mask) >= ((slot - gap) & mask))
+        {
+            part->slots[gap] = part->slots[slot];
+            gap = slot;
+        }
+    }
+    part->slots[gap] = -1;
+    part->count--;
+}
+
+// Frame index holding pageNum, -1 if the page is not in the pool. Without a pin on the page
+// the answer may be out of date as soon as it is returned
+static int lookupFrame(MgmtInfo *mgmtData, PageNumber pageNum)
+{
+    if (pageNum < 0)
+        return -1;
+
+    PagePartition *part = partitionOf(mgmtData, pageNum);
+    pthread_mutex_lock(&part->lock);
+    int frameNum = partitionFind(mgmtData, part, pageNum);
+    pthread_mutex_unlock(&part->lock);
+    return frameNum;
+}
+
+// Pin the frame holding pageNum if the page is in the pool. Returns the frame index, -1 if the page is not there
+static int pinCached(MgmtInfo *mgmtData, PageNumber pageNum)
+{
+    if (pageNum < 0)
+        return -1;
+
+    PagePartition *part = partitionOf(mgmtData, pageNum);
+    pthread_mutex_lock(&part->lock);
+    int frameNum = partitionFind(mgmtData, part, pageNum);
+    if (frameNum != -1)
+        __atomic_fetch_add(&mgmtData->frames[frameNum].fixCount, 1, __ATOMIC_ACQ_REL);
+    pthread_mutex_unlock(&part->lock);
+    return frameNum;
+}
+
+// Allocate an empty page index for up to entries pages (it gets at least twice as many slots).
+// Returns false if out of memory
+static bool initPageIndex(PageIndex *index, int entries)
+{
+    int size = 1;
+    while (size < 2 * entries)
+        size <<= 1;
+
+    index->pages = malloc(sizeof(PageNumber) * size);
+    index->values = malloc(sizeof(int) * size);
+    index->mask = size - 1;
+    if (index->pages == NULL || index->values == NULL)
+    {
+        free(index->pages);
+        free(index->values);
+        index->pages = NULL;
+        index->values = NULL;
+        return false;
+    }
+    for (int i = 0; i < size; i++)
+        index->pages[i] = NO_PAGE;
+    return true;
+}
+
+static void freePageIndex(PageIndex *index)
+{
+    free(index->pages);
+    free(index->values);
+}
+
+// Slot of pageNum in the index, -1 if it is not there
+static int pageIndexFind(PageIndex *index, PageNumber pageNum)
+{
+    for (int slot = hashPage(pageNum, index->mask); index->pages[slot] != NO_PAGE; slot = (slot + 1) & index->mask)
+    {
+        if (index->pages[slot] == pageNum)
+            return slot;
+    }
+    return -1;
+}
+
+static void pageIndexInsert(PageIndex *index, PageNumber pageNum, int value)
+{
+    int slot = hashPage(pageNum, index->mask);
+    while (index->pages[slot] != NO_PAGE)
+        slot = (slot + 1) & index->mask;
+    index->pages[slot] = pageNum;
+    index->values[slot] = value;
+}
+
+// Empty a slot of the index, moving later entries back into the gap (as removeFrame does for the page table)
+static void pageIndexRemove(PageIndex *index, int gap)
+{
+    int mask = index->mask;
+    for (int slot = (gap + 1) & mask; index->pages[slot] != NO_PAGE; slot = (slot + 1) & mask)
+    {
+        int home = hashPage(index->pages[slot], mask);
+        if (((slot - home) & mask) >= ((slot - gap) & mask))
+        {
+            index->pages[gap] = index->pages[slot];
+            index->values[gap] = index->values[slot];
+            gap = slot;
+        }
+    }
+    index->pages[gap] = NO_PAGE;
+}
+
+// Take an unused bucket node for frequency freq and link it between buckets prev and next
+static int lfuNewBucket(MgmtInfo *mgmtData, int freq, int prev, int next)
+{
+    LFUBucket *buckets = mgmtData->lfuBuckets;
+    int b = mgmtData->lfuFreeBucket;
+    mgmtData->lfuFreeBucket = buckets[b].next;
+
+    buckets[b].freq = freq;
+    buckets[b].prev = prev;
+    buckets[b].next = next;
+    buckets[b].head = -1;
+    buckets[b].tail = -1;
+    if (prev != -1)
+        buckets[prev].next = b;
+    else
+        mgmtData->lfuFirst = b;
+    if (next != -1)
+        buckets[next].prev = b;
+    return b;
+}
+
+// Put frame frameNum at the head of the frame list of bucket b
+static void lfuLink(MgmtInfo *mgmtData, int frameNum, int b)
+{
+    LFUBucket *bucket = &mgmtData->lfuBuckets[b];
+    PageFrame *frames = mgmtData->frames;
+
+    frames[frameNum].lfuBucket = b;
+    frames[frameNum].lfuPrev = -1;
+    frames[frameNum].lfuNext = bucket->head;
+    if (bucket->head != -1)
+        frames[bucket->head].lfuPrev = frameNum;
+    else
+        bucket->tail = frameNum;
+    bucket->head = frameNum;
+}
+
+// Take frame frameNum out of its bucket, a bucket left empty goes back to the unused nodes
+static void lfuUnlink(MgmtInfo *mgmtData, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    if (mgmtData->lfuBuckets == NULL || frame->lfuBucket == -1)
+        return;
+
+    LFUBucket *buckets = mgmtData->lfuBuckets;
+    int b = frame->lfuBucket;
+    if (frame->lfuPrev != -1)
+        mgmtData->frames[frame->lfuPrev].lfuNext = frame->lfuNext;
+    else
+        buckets[b].head = frame->lfuNext;
+    if (frame->lfuNext != -1)
+        mgmtData->frames[frame->lfuNext].lfuPrev = frame->lfuPrev;
+    else
+        buckets[b].tail = frame->lfuPrev;
+    frame->lfuBucket = -1;
+
+    if (buckets[b].head == -1)
+    {
+        if (buckets[b].prev != -1)
+            buckets[buckets[b].prev].next = buckets[b].next;
+        else
+            mgmtData->lfuFirst = buckets[b].next;
+        if (buckets[b].next != -1)
+            buckets[buckets[b].next].prev = buckets[b].prev;
+        buckets[b].next = mgmtData->lfuFreeBucket;
+        mgmtData->lfuFreeBucket = b;
+    }
+}
+
+// A page was just loaded into frame frameNum: it has been pinned once
+static void lfuInsert(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->lfuBuckets == NULL)
+        return;
+
+    // Frequencies are never below 1, so a bucket for 1 can only be the first one
+    int first = mgmtData->lfuFirst;
+    if (first == -1 || mgmtData->lfuBuckets[first].freq != 1)
+        first = lfuNewBucket(mgmtData, 1, -1, first);
+    lfuLink(mgmtData, frameNum, first);
+}
+
+// Halve all frequencies (never below 1), so pages that were hot long ago can be evicted again.
+// Buckets that end up with the same frequency are merged, the frames of the hotter one go first
+static void lfuAge(MgmtInfo *mgmtData)
+{
+    LFUBucket *buckets = mgmtData->lfuBuckets;
+    int b = mgmtData->lfuFirst;
+    while (b != -1)
+    {
+        int next = buckets[b].next;
+        buckets[b].freq = (buckets[b].freq > 1) ? buckets[b].freq / 2 : 1;
+
+        int prev = buckets[b].prev;
+        if (prev != -1 && buckets[prev].freq == buckets[b].freq)
+        {
+            for (int f = buckets[b].head; f != -1; f = mgmtData->frames[f].lfuNext)
+                mgmtData->frames[f].lfuBucket = prev;
+            mgmtData->frames[buckets[b].tail].lfuNext = buckets[prev].head;
+            mgmtData->frames[buckets[prev].head].lfuPrev = buckets[b].tail;
+            buckets[prev].head = buckets[b].head;
+
+            buckets[prev].next = next;
+            if (next != -1)
+                buckets[next].prev = prev;
+            buckets[b].next = mgmtData->lfuFreeBucket;
+            mgmtData->lfuFreeBucket = b;
+        }
+        b = next;
+    }
+}
+
+// The page in frame frameNum was pinned again: move it to the bucket of the next higher frequency
+static void lfuTouch(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->lfuBuckets == NULL)
+        return;
+
+    LFUBucket *buckets = mgmtData->lfuBuckets;
+    int b = mgmtData->frames[frameNum].lfuBucket;
+    if (b != -1)
+    {
+        // The spare bucket node covers the new bucket made while the old one still holds the frame
+        int next = buckets[b].next;
+        if (next == -1 || buckets[next].freq != buckets[b].freq + 1)
+            next = lfuNewBucket(mgmtData, buckets[b].freq + 1, b, next);
+        lfuUnlink(mgmtData, frameNum);
+        lfuLink(mgmtData, frameNum, next);
+    }
+}
+
+// Count a pin (hit or miss) towards the next aging
+static void lfuCountPin(MgmtInfo *mgmtData)
+{
+    if (mgmtData->lfuAgingInterval > 0 && ++mgmtData->lfuPins >= mgmtData->lfuAgingInterval)
+    {
+        lfuAge(mgmtData);
+        mgmtData->lfuPins = 0;
+    }
+}
+
+// Replacement list of the FIFO and LRU strategies, linked through the frames (listPrev/listNext).
+// FIFO keeps every cached frame in load order: pinning does not change the order, pinned frames are skipped.
+// LRU keeps the unpinned cached frames only, in the order their last pin was released
+#define LIST_NONE 0
+#define LIST_FIFO 1
+#define LIST_LRU  2
+
+// Put frame frameNum (which is in no list) at the newest end of list
+static void listPush(MgmtInfo *mgmtData, FrameList *list, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    frame->list = list;
+    frame->listPrev = -1;
+    frame->listNext = list->newest;
+    if (list->newest != -1)
+        mgmtData->frames[list->newest].listPrev = frameNum;
+    else
+        list->oldest = frameNum;
+    list->newest = frameNum;
+    list->size++;
+}
+
+// Take frame frameNum out of its list, if it is in one
+static void listUnlink(MgmtInfo *mgmtData, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    FrameList *list = frame->list;
+    if (list == NULL)
+        return;
+
+    frame->list = NULL;
+    if (frame->listPrev != -1)
+        mgmtData->frames[frame->listPrev].listNext = frame->listNext;
+    else
+        list->newest = frame->listNext;
+    if (frame->listNext != -1)
+        mgmtData->frames[frame->listNext].listPrev = frame->listPrev;
+    else
+        list->oldest = frame->listPrev;
+    list->size--;
+}
+
+// A page was loaded into frame frameNum, pinned or not (prefetchPages)
+static void listLoaded(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->listMode == LIST_FIFO || (mgmtData->listMode == LIST_LRU && FIX_COUNT(&mgmtData->frames[frameNum]) == 0))
+        listPush(mgmtData, &mgmtData->list, frameNum);
+}
+
+// The page in frame frameNum was pinned: under LRU it cannot be chosen until it is unpinned again
+static void listPinned(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->listMode == LIST_LRU)
+        listUnlink(mgmtData, frameNum);
+}
+
+// The last pin of the page in frame frameNum was released: under LRU it is now the most recently used page
+static void listReleased(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->listMode == LIST_LRU && mgmtData->frames[frameNum].list == NULL)
+        listPush(mgmtData, &mgmtData->list, frameNum);
+}
+
+// Reference i (0 = most recent) of the page in frame f under LRU-K
+#define LRUK_HIST(m, f, i) ((m)->lrukHist[(f) * (m)->lrukK + (i)])
+
+// True if frame a is a better LRU-K victim than frame b: its K-th most recent reference is older
+// (a page with fewer than K references has none, which is oldest), or the same and its last pin is older
+static bool lrukBefore(MgmtInfo *mgmtData, int a, int b)
+{
+    int k = mgmtData->lrukK - 1;
+    if (LRUK_HIST(mgmtData, a, k) != LRUK_HIST(mgmtData, b, k))
+        return LRUK_HIST(mgmtData, a, k) < LRUK_HIST(mgmtData, b, k);
+    return mgmtData->frames[a].lrukLast < mgmtData->frames[b].lrukLast;
+}
+
+static void lrukHeapSet(MgmtInfo *mgmtData, int pos, int frameNum)
+{
+    mgmtData->lrukHeap[pos] = frameNum;
+    mgmtData->frames[frameNum].heapPos = pos;
+}
+
+// Restore the heap order around position pos after the frame there was placed
+static void lrukSift(MgmtInfo *mgmtData, int pos)
+{
+    int *heap = mgmtData->lrukHeap;
+    int frameNum = heap[pos];
+
+    while (pos > 0 && lrukBefore(mgmtData, frameNum, heap[(pos - 1) / 2]))
+    {
+        lrukHeapSet(mgmtData, pos, heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    for (;;)
+    {
+        int child = 2 * pos + 1;
+        if (child >= mgmtData->lrukHeapSize)
+            break;
+        if (child + 1 < mgmtData->lrukHeapSize && lrukBefore(mgmtData, heap[child + 1], heap[child]))
+            child++;
+        if (!lrukBefore(mgmtData, heap[child], frameNum))
+            break;
+        lrukHeapSet(mgmtData, pos, heap[child]);
+        pos = child;
+    }
+    lrukHeapSet(mgmtData, pos, frameNum);
+}
+
+// Frame frameNum holds a page and is no longer pinned: it can be chosen as victim
+static void lrukHeapPush(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->lrukK == 0 || mgmtData->frames[frameNum].heapPos != -1)
+        return;
+    lrukHeapSet(mgmtData, mgmtData->lrukHeapSize++, frameNum);
+    lrukSift(mgmtData, mgmtData->lrukHeapSize - 1);
+}
+
+// Frame frameNum is pinned or evicted, it cannot be chosen as victim
+static void lrukHeapRemove(MgmtInfo *mgmtData, int frameNum)
+{
+    int pos = (mgmtData->lrukK != 0) ? mgmtData->frames[frameNum].heapPos : -1;
+    if (pos == -1)
+        return;
+
+    mgmtData->frames[frameNum].heapPos = -1;
+    int last = mgmtData->lrukHeap[--mgmtData->lrukHeapSize];
+    if (last != frameNum)
+    {
+        lrukHeapSet(mgmtData, pos, last);
+        lrukSift(mgmtData, pos);
+    }
+}
+
+// The page in frame frameNum is evicted: remember its references in the history,
+// replacing the oldest entry, so they are known again if the page comes back soon
+static void lrukRemember(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->lrukK == 0 || mgmtData->frames[frameNum].pageNum == NO_PAGE || mgmtData->lrukHistorySize == 0)
+        return;
+
+    int k = mgmtData->lrukK;
+    int entry = mgmtData->lrukHistoryNext;
+    mgmtData->lrukHistoryNext = (entry + 1) % mgmtData->lrukHistorySize;
+    if (mgmtData->lrukHistoryPage[entry] != NO_PAGE)
+        pageIndexRemove(&mgmtData->lrukIndex, pageIndexFind(&mgmtData->lrukIndex, mgmtData->lrukHistoryPage[entry]));
+
+    PageNumber pageNum = mgmtData->frames[frameNum].pageNum;
+    mgmtData->lrukHistoryPage[entry] = pageNum;
+    mgmtData->lrukHistoryLast[entry] = mgmtData->frames[frameNum].lrukLast;
+    memcpy(&mgmtData->lrukHistoryHist[entry * k], &LRUK_HIST(mgmtData, frameNum, 0), sizeof(int) * k);
+    pageIndexInsert(&mgmtData->lrukIndex, pageNum, entry);
+}
+
+// Page pageNum is loaded into frame frameNum: take its references from the history, or start without any
+static void lrukRecall(MgmtInfo *mgmtData, int frameNum, PageNumber pageNum)
+{
+    if (mgmtData->lrukK == 0)
+        return;
+
+    int k = mgmtData->lrukK;
+    int slot = pageIndexFind(&mgmtData->lrukIndex, pageNum);
+    if (slot == -1)
+    {
+        memset(&LRUK_HIST(mgmtData, frameNum, 0), 0, sizeof(int) * k);
+        mgmtData->frames[frameNum].lrukLast = 0;
+        return;
+    }
+
+    int entry = mgmtData->lrukIndex.values[slot];
+    memcpy(&LRUK_HIST(mgmtData, frameNum, 0), &mgmtData->lrukHistoryHist[entry * k], sizeof(int) * k);
+    mgmtData->frames[frameNum].lrukLast = mgmtData->lrukHistoryLast[entry];
+    mgmtData->lrukHistoryPage[entry] = NO_PAGE;
+    pageIndexRemove(&mgmtData->lrukIndex, slot);
+}
+
+// The page in frame frameNum is pinned. A pin within the correlated reference period of the last one
+// belongs to the same reference and only moves the last pin time. Otherwise it is a new reference;
+// the older ones move up by the length of the previous correlated period, so a burst of pins counts
+// as a single reference at its start
+static void lrukReference(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->lrukK == 0)
+        return;
+
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    int now = ++mgmtData->lrukClock;
+    if (LRUK_HIST(mgmtData, frameNum, 0) != 0 && now - frame->lrukLast <= mgmtData->lrukCorrelatedPeriod)
+    {
+        frame->lrukLast = now;
+        return;
+    }
+
+    int correlated = (LRUK_HIST(mgmtData, frameNum, 0) != 0) ? frame->lrukLast - LRUK_HIST(mgmtData, frameNum, 0) : 0;
+    for (int i = mgmtData->lrukK - 1; i > 0; i--)
+    {
+        int previous = LRUK_HIST(mgmtData, frameNum, i - 1);
+        LRUK_HIST(mgmtData, frameNum, i) = (previous != 0) ? previous + correlated : 0;
+    }
+    LRUK_HIST(mgmtData, frameNum, 0) = now;
+    frame->lrukLast = now;
+}
+
+// ARC (Megiddo and Modha): T1 holds pages seen once recently, T2 pages seen at least twice.
+// B1 and B2 remember the numbers of pages recently evicted from T1 and T2. A miss on a page in B1 means
+// T1 was too small and raises the target size p of T1, a miss on a page in B2 lowers it. The victim comes
+// from T1 while T1 is larger than p, otherwise from T2, so a long scan only ever replaces pages of T1
+// and the pages used repeatedly stay in T2. Pinned frames stay in their list and are stepped over
+
+// Put ghost node g (which is in no list) at the newest end of ghost list list
+static void arcGhostPush(MgmtInfo *mgmtData, FrameList *list, int g)
+{
+    ArcGhost *ghosts = mgmtData->arcGhosts;
+    ghosts[g].list = list;
+    ghosts[g].prev = -1;
+    ghosts[g].next = list->newest;
+    if (list->newest != -1)
+        ghosts[list->newest].prev = g;
+    else
+        list->oldest = g;
+    list->newest = g;
+    list->size++;
+    pageIndexInsert(&mgmtData->arcGhostIndex, ghosts[g].pageNum, g);
+}
+
+// Forget ghost g: take it out of its list and the index and make the node unused
+static void arcGhostDrop(MgmtInfo *mgmtData, int g)
+{
+    ArcGhost *ghosts = mgmtData->arcGhosts;
+    if (g == -1 || ghosts[g].list == NULL)
+        return;
+
+    FrameList *list = ghosts[g].list;
+    if (ghosts[g].prev != -1)
+        ghosts[ghosts[g].prev].next = ghosts[g].next;
+    else
+        list->newest = ghosts[g].next;
+    if (ghosts[g].next != -1)
+        ghosts[ghosts[g].next].prev = ghosts[g].prev;
+    else
+        list->oldest = ghosts[g].prev;
+    list->size--;
+    pageIndexRemove(&mgmtData->arcGhostIndex, pageIndexFind(&mgmtData->arcGhostIndex, ghosts[g].pageNum));
+
+    ghosts[g].list = NULL;
+    ghosts[g].next = mgmtData->arcFreeGhost;
+    mgmtData->arcFreeGhost = g;
+}
+
+// Page pageNum is not cached and is about to be loaded into a pool of c frames:
+// adapt p and trim the ghost lists as ARC does on a miss, before the victim is chosen
+static void arcMiss(MgmtInfo *mgmtData, PageNumber pageNum, int c)
+{
+    if (mgmtData->arcGhosts == NULL)
+        return;
+
+    mgmtData->arcFromB2 = false;
+    mgmtData->arcToT2 = false;
+    mgmtData->arcNoGhost = false;
+
+    int slot = pageIndexFind(&mgmtData->arcGhostIndex, pageNum);
+    if (slot != -1)
+    {
+        int g = mgmtData->arcGhostIndex.values[slot];
+        int b1 = mgmtData->arcB1.size;
+        int b2 = mgmtData->arcB2.size;
+        if (mgmtData->arcGhosts[g].list == &mgmtData->arcB1)
+        {
+            int delta = (b2 > b1) ? b2 / b1 : 1;
+            mgmtData->arcTarget = (mgmtData->arcTarget + delta < c) ? mgmtData->arcTarget + delta : c;
+        }
+        else
+        {
+            int delta = (b1 > b2) ? b1 / b2 : 1;
+            mgmtData->arcTarget = (mgmtData->arcTarget - delta > 0) ? mgmtData->arcTarget - delta : 0;
+            mgmtData->arcFromB2 = true;
+        }
+        arcGhostDrop(mgmtData, g);
+        mgmtData->arcToT2 = true;
+        return;
+    }
+
+    int l1 = mgmtData->arcT1.size + mgmtData->arcB1.size;
+    int l2 = mgmtData->arcT2.size + mgmtData->arcB2.size;
+    if (l1 >= c)
+    {
+        if (mgmtData->arcT1.size < c)
+            arcGhostDrop(mgmtData, mgmtData->arcB1.oldest);
+        else
+            mgmtData->arcNoGhost = true;    // T1 alone fills the pool, its victim is not remembered
+    }
+    else if (l1 + l2 >= 2 * c)
+    {
+        arcGhostDrop(mgmtData, mgmtData->arcB2.oldest);
+    }
+}
+
+// Oldest unpinned frame of list, -1 if there is none
+static int arcOldestUnpinned(MgmtInfo *mgmtData, FrameList *list)
+{
+    for (int i = list->oldest; i != -1; i = mgmtData->frames[i].listPrev)
+    {
+        if (FIX_COUNT(&mgmtData->frames[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// The list ARC takes its next victim from: T1 if it is larger than p (or as large, when the page comes from B2),
+// otherwise T2
+static bool arcPrefersT1(MgmtInfo *mgmtData)
+{
+    int t1 = mgmtData->arcT1.size;
+    return t1 > 0 && (t1 > mgmtData->arcTarget || (mgmtData->arcFromB2 && t1 == mgmtData->arcTarget));
+}
+
+// ARC victim: the oldest unpinned frame of the list arcPrefersT1 picks.
+// If all frames of that list are pinned the other list gives the victim
+static int arcReplace(MgmtInfo *mgmtData)
+{
+    bool fromT1 = arcPrefersT1(mgmtData);
+    int victim = arcOldestUnpinned(mgmtData, fromT1 ? &mgmtData->arcT1 : &mgmtData->arcT2);
+    if (victim == -1)
+        victim = arcOldestUnpinned(mgmtData, fromT1 ? &mgmtData->arcT2 : &mgmtData->arcT1);
+    return victim;
+}
+
+// The page in frame frameNum is evicted: it becomes a ghost in B1 (from T1) or B2 (from T2)
+static void arcEvict(MgmtInfo *mgmtData, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    if (mgmtData->arcGhosts == NULL || frame->list == NULL)
+        return;
+
+    FrameList *ghostList = (frame->list == &mgmtData->arcT1) ? &mgmtData->arcB1 : &mgmtData->arcB2;
+    bool keepGhost = !(ghostList == &mgmtData->arcB1 && frame->arcNoGhost);
+    listUnlink(mgmtData, frameNum);
+    if (!keepGhost)
+        return;
+
+    // A victim from the other list than arcReplace preferred (all its frames were pinned) can leave
+    // one ghost too many, then the oldest ghost of the longer list makes room
+    if (mgmtData->arcFreeGhost == -1)
+    {
+        FrameList *longer = (mgmtData->arcB1.size > mgmtData->arcB2.size) ? &mgmtData->arcB1 : &mgmtData->arcB2;
+        arcGhostDrop(mgmtData, longer->oldest);
+    }
+    int g = mgmtData->arcFreeGhost;
+    mgmtData->arcFreeGhost = mgmtData->arcGhosts[g].next;
+    mgmtData->arcGhosts[g].pageNum = frame->pageNum;
+    arcGhostPush(mgmtData, ghostList, g);
+}
+
+// Frame frameNum was chosen for the page of the last arcMiss. The frame keeps arcMiss's decisions for the
+// eviction of its old page and the load of the new one, which may happen after other misses
+static void arcClaimed(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->arcGhosts == NULL)
+        return;
+
+    mgmtData->frames[frameNum].arcToT2 = mgmtData->arcToT2;
+    mgmtData->frames[frameNum].arcNoGhost = mgmtData->arcNoGhost;
+    mgmtData->arcToT2 = false;
+    mgmtData->arcNoGhost = false;
+    mgmtData->arcFromB2 = false;
+}
+
+// A page was loaded into frame frameNum after arcMiss: a page remembered as ghost goes to T2, others to T1.
+// pinned: the load is the first reference of the page; a prefetched page is referenced by its first pin
+static void arcLoaded(MgmtInfo *mgmtData, int frameNum, bool pinned)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    if (mgmtData->arcGhosts == NULL || frame->list != NULL)
+        return;
+
+    frame->arcReferenced = pinned;
+    frame->arcLastRef = pinned ? ++mgmtData->arcClock : mgmtData->arcClock;
+    listPush(mgmtData, frame->arcToT2 ? &mgmtData->arcT2 : &mgmtData->arcT1, frameNum);
+}
+
+// The page in frame frameNum was pinned again; shared: another client had it pinned too. A second reference
+// makes it the most recently used page of T2. Pins correlated with the previous reference are none, as the
+// first pin of a prefetched page: those while the page is still pinned and one right after it with no other
+// page referenced in between, such as the pins of a scan reading one record after another. Then the page only
+// becomes the most recently used page of its list, so a long scan passes through T1 and leaves T2 alone
+static void arcHit(MgmtInfo *mgmtData, int frameNum, bool shared)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    if (mgmtData->arcGhosts == NULL)
+        return;
+
+    unsigned now = ++mgmtData->arcClock;
+    bool correlated = !frame->arcReferenced || shared || frame->arcLastRef == now - 1;
+    FrameList *list = (correlated && frame->list != NULL) ? frame->list : &mgmtData->arcT2;
+    frame->arcReferenced = true;
+    frame->arcLastRef = now;
+    listUnlink(mgmtData, frameNum);
+    listPush(mgmtData, list, frameNum);
+}
+
+// Set up the ARC strategy for a pool of numPages frames. Returns false if out of memory
+static bool initARC(MgmtInfo *mgmtData, int numPages)
+{
+    FrameList empty = {.newest = -1, .oldest = -1, .size = 0};
+    mgmtData->arcT1 = empty;
+    mgmtData->arcT2 = empty;
+    mgmtData->arcB1 = empty;
+    mgmtData->arcB2 = empty;
+    mgmtData->arcTarget = 0;
+    mgmtData->arcGhosts = malloc(sizeof(ArcGhost) * numPages);
+    if (mgmtData->arcGhosts == NULL || !initPageIndex(&mgmtData->arcGhostIndex, numPages))
+    {
+        free(mgmtData->arcGhosts);
+        mgmtData->arcGhosts = NULL;
+        return false;
+    }
+
+    for (int i = 0; i < numPages; i++)
+    {
+        mgmtData->arcGhosts[i].list = NULL;
+        mgmtData->arcGhosts[i].next = (i + 1 < numPages) ? i + 1 : -1;
+    }
+    mgmtData->arcFreeGhost = 0;
+    return true;
+}
+
+// Release what initARC allocated
+static void freeARC(MgmtInfo *mgmtData)
+{
+    if (mgmtData->arcGhosts == NULL)
+        return;
+    free(mgmtData->arcGhosts);
+    freePageIndex(&mgmtData->arcGhostIndex);
+}
+
+// Release what initLRUK allocated
+static void freeLRUK(MgmtInfo *mgmtData)
+{
+    free(mgmtData->lrukHist);
+    free(mgmtData->lrukHeap);
+    free(mgmtData->lrukHistoryPage);
+    free(mgmtData->lrukHistoryLast);
+    free(mgmtData->lrukHistoryHist);
+    freePageIndex(&mgmtData->lrukIndex);
+}
+
+// Set up the LRU-K strategy for a pool of numPages frames (options may be NULL). Returns false if out of memory
+static bool initLRUK(MgmtInfo *mgmtData, int numPages, const BM_LRUKOptions *options)
+{
+    int k = (options != NULL && options->k > 0) ? options->k : 1;
+    int historySize = (options != NULL && options->historySize > 0) ? options->historySize : numPages;
+
+    mgmtData->lrukK = k;
+    mgmtData->lrukCorrelatedPeriod = (options != NULL && options->correlatedPeriod > 0) ? options->correlatedPeriod : 0;
+    mgmtData->lrukClock = 0;
+    mgmtData->lrukHist = calloc((size_t)numPages * k, sizeof(int));
+    mgmtData->lrukHeap = malloc(sizeof(int) * numPages);
+    mgmtData->lrukHeapSize = 0;
+    mgmtData->lrukHistoryPage = malloc(sizeof(PageNumber) * historySize);
+    mgmtData->lrukHistoryLast = malloc(sizeof(int) * historySize);
+    mgmtData->lrukHistoryHist = malloc(sizeof(int) * historySize * k);
+    mgmtData->lrukHistorySize = historySize;
+    mgmtData->lrukHistoryNext = 0;
+    if (!initPageIndex(&mgmtData->lrukIndex, historySize) ||
+        mgmtData->lrukHist == NULL || mgmtData->lrukHeap == NULL || mgmtData->lrukHistoryPage == NULL ||
+        mgmtData->lrukHistoryLast == NULL || mgmtData->lrukHistoryHist == NULL)
+    {
+        freeLRUK(mgmtData);
+        return false;
+    }
+
+    for (int i = 0; i < historySize; i++)
+        mgmtData->lrukHistoryPage[i] = NO_PAGE;
+    return true;
+}
+
+// qsort comparator ordering frame pointers by page number
+static int comparePageNum(const void *a, const void *b)
+{
+    const PageFrame *frameA = *(PageFrame *const *)a;
+    const PageFrame *frameB = *(PageFrame *const *)b;
+    return (frameA->pageNum > frameB->pageNum) - (frameA->pageNum < frameB->pageNum);
+}
+
+// Function to find a frame to replace based on the replacement strategy
+extern int findFrameToReplace(BM_BufferPool *bm) 
+{
+    MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
+    PageFrame *frames = (PageFrame *)mgmtData->frames;
+    switch (bm->strategy) {
+        case RS_FIFO:
+        // FIFO strategy: the oldest loaded frame that is not pinned.
+        // Only frames pinned while they reach the old end of the list are stepped over
+            {
+                for (int i = mgmtData->list.oldest; i != -1; i = frames[i].listPrev) 
+                {
+                    if (FIX_COUNT(&frames[i]) == 0) 
+                    {
+                        return i;
+                    }
+                }
+
+                return -1;
+            }
+        case RS_LRU:
+        // LRU strategy: the list holds unpinned frames only, its oldest end is the least recently used page
+            {
+                return mgmtData->list.oldest;
+            }
+        case RS_CLOCK:
+        // CLOCK strategy: sweep the hand over the frames, a referenced frame loses its reference bit
+        // and gets a second chance, the first unreferenced unpinned frame is the victim.
+        // Two full turns clear every bit, so after them all frames are pinned
+            {
+                for (int step = 0; step < 2 * bm->numPages; step++) 
+                {
+                    int i = mgmtData->clockHand;
+                    mgmtData->clockHand = (i + 1) % bm->numPages;
+                    if (FIX_COUNT(&frames[i]) == 0) 
+                    {
+                        if (!__atomic_exchange_n(&frames[i].referenced, false, __ATOMIC_RELAXED)) 
+                        {
+                            return i;
+                        }
+                    }
+                }
+
+                return -1;
+            }
+        case RS_LFU:
+        // LFU strategy: the least recently pinned unpinned frame of the lowest frequency bucket.
+        // Pinned frames are few, so this usually looks at the tail of the first bucket only
+            {
+                LFUBucket *buckets = mgmtData->lfuBuckets;
+                for (int b = mgmtData->lfuFirst; b != -1; b = buckets[b].next) 
+                {
+                    for (int i = buckets[b].tail; i != -1; i = frames[i].lfuPrev) 
+                    {
+                        if (FIX_COUNT(&frames[i]) == 0) 
+                        {
+                            return i;
+                        }
+                    }
+                }
+
+                return -1;
+            }
+        case RS_ARC:
+        // ARC strategy: see arcReplace
+            {
+                return arcReplace(mgmtData);
+            }
+        case RS_LRU_K:
+        // LRU-K strategy: the top of the heap of unpinned frames
+            {
+                return (mgmtData->lrukHeapSize > 0) ? mgmtData->lrukHeap[0] : -1;
+            }
+        default:
+            return -1;
+    }
+    return -1;
+}
+
+// Map an arena of size bytes for the frames. Anonymous mappings are zero filled and page aligned, so every
+// frame is SM_PAGE_ALIGNMENT aligned for direct I/O. With hugePages the arena is taken from the huge page pool
+// (MAP_HUGETLB) if one is configured, otherwise transparent huge pages are requested for it.
+// Stores the mapped size in *mapped. Returns NULL if out of memory
+static char *mapFrameArena(size_t size, bool hugePages, size_t *mapped)
+{
+    void *arena = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (hugePages)
+    {
+        size_t hugeSize = (size + BM_HUGE_PAGE_SIZE - 1) / BM_HUGE_PAGE_SIZE * BM_HUGE_PAGE_SIZE;
+        arena = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena != MAP_FAILED)
+        {
+            *mapped = hugeSize;
+            return arena;
+        }
+    }
+#endif
+
+    arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+    if (hugePages)
+        madvise(arena, size, MADV_HUGEPAGE);    // only a hint, the arena works without it
+#endif
+    *mapped = size;
+    return arena;
+}
+
+// Put empty frame frameNum on the free frame stack. The caller holds poolLock
+static void pushFreeFrame(MgmtInfo *mgmtData, int frameNum)
+{
+    if (mgmtData->frames[frameNum].freeListed)
+        return;
+    mgmtData->frames[frameNum].freeListed = true;
+    mgmtData->freeFrames[mgmtData->numFreeFrames++] = frameNum;
+}
+
+// Kinds of FrameEvent
+#define EVENT_HIT 0         // The cached page of the frame was pinned again
+#define EVENT_SHARED_HIT 1  // The same, while another client had the page pinned
+#define EVENT_RELEASE 2     // The last pin of the frame was released (LRU and LRU-K only)
+
+// Apply the events in the ring in the order they were logged. Events of frames that lost their page since,
+// or are being evicted or loaded, are dropped. The caller holds poolLock
+static void applyEvents(MgmtInfo *mgmtData)
+{
+    if (mgmtData->events == NULL)
+        return;
+
+    unsigned head = mgmtData->eventHead;
+    unsigned tail = __atomic_load_n(&mgmtData->eventTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        // The thread that took the position writes the event right after, without waiting for anything
+        FrameEvent *event = &mgmtData->events[head & (BM_EVENT_RING - 1)];
+        while (__atomic_load_n(&event->seq, __ATOMIC_ACQUIRE) != head + 1)
+            sched_yield();
+
+        int frameNum = event->frameNum;
+        PageFrame *frame = &mgmtData->frames[frameNum];
+        if (event->pageNum == NO_PAGE || PAGE_NUM(frame) != event->pageNum || IS_BUSY(frame))
+            continue;
+
+        if (event->kind == EVENT_RELEASE)
+        {
+            // The frame may have been pinned again since, then it stays out of the list and heap
+            if (FIX_COUNT(frame) == 0)
+            {
+                lrukHeapPush(mgmtData, frameNum);
+                listReleased(mgmtData, frameNum);
+            }
+            continue;
+        }
+        lfuTouch(mgmtData, frameNum);
+        lfuCountPin(mgmtData);
+        lrukHeapRemove(mgmtData, frameNum);
+        lrukReference(mgmtData, frameNum);
+        listPinned(mgmtData, frameNum);
+        arcHit(mgmtData, frameNum, event->kind == EVENT_SHARED_HIT);
+    }
+    __atomic_store_n(&mgmtData->eventHead, head, __ATOMIC_RELEASE);
+}
+
+// Log an event of frame frameNum, which holds page pageNum. The position in the ring is taken atomically,
+// so hits and unpins of different threads wait for no lock. It is only taken while the ring has room;
+// if the ring is full the thread applies the events itself first
+static void logEvent(MgmtInfo *mgmtData, int frameNum, PageNumber pageNum, int kind)
+{
+    unsigned pos = __atomic_load_n(&mgmtData->eventTail, __ATOMIC_RELAXED);
+    unsigned used;
+    for (;;)
+    {
+        used = pos - __atomic_load_n(&mgmtData->eventHead, __ATOMIC_ACQUIRE);
+        if (used >= BM_EVENT_RING)
+        {
+            pthread_mutex_lock(&mgmtData->poolLock);
+            applyEvents(mgmtData);
+            pthread_mutex_unlock(&mgmtData->poolLock);
+            pos = __atomic_load_n(&mgmtData->eventTail, __ATOMIC_RELAXED);
+        }
+        else if (__atomic_compare_exchange_n(&mgmtData->eventTail, &pos, pos + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+    }
+
+    FrameEvent *event = &mgmtData->events[pos & (BM_EVENT_RING - 1)];
+    event->kind = kind;
+    event->frameNum = frameNum;
+    event->pageNum = pageNum;
+    __atomic_store_n(&event->seq, pos + 1, __ATOMIC_RELEASE);
+
+    if (used >= BM_EVENT_RING / 2 && pthread_mutex_trylock(&mgmtData->poolLock) == 0)
+    {
+        applyEvents(mgmtData);
+        pthread_mutex_unlock(&mgmtData->poolLock);
+    }
+}
+
+// Release one pin of frame frameNum. When the last pin goes, LRU and LRU-K make the frame a victim candidate again
+static void unpinFrame(MgmtInfo *mgmtData, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    PageNumber pageNum = PAGE_NUM(frame);
+    if (__atomic_sub_fetch(&frame->fixCount, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+
+    // An empty frame goes on the free frame stack: a claim gave it up, or a pin waited for it while it lost
+    // its page. claimVictim drops a stack entry of a frame still pinned, its last unpin pushes it again
+    if (PAGE_NUM(frame) == NO_PAGE)
+    {
+        pthread_mutex_lock(&mgmtData->poolLock);
+        if (FIX_COUNT(frame) == 0 && PAGE_NUM(frame) == NO_PAGE)
+            pushFreeFrame(mgmtData, frameNum);
+        pthread_mutex_unlock(&mgmtData->poolLock);
+        return;
+    }
+    if (mgmtData->listMode != LIST_LRU && mgmtData->lrukK == 0)
+        return;
+
+    logEvent(mgmtData, frameNum, pageNum, EVENT_RELEASE);
+}
+
+// The cached page in frame frameNum was pinned again: set its CLOCK reference bit and log the hit for
+// the other strategies. The caller holds a pin of the frame
+static void frameHit(MgmtInfo *mgmtData, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    __atomic_store_n(&frame->referenced, true, __ATOMIC_RELAXED);
+    if (!mgmtData->loggedHits)
+        return;
+
+    logEvent(mgmtData, frameNum, PAGE_NUM(frame), (FIX_COUNT(frame) > 1) ? EVENT_SHARED_HIT : EVENT_HIT);
+}
+
+// The page in frame frameNum was just read in: enter it into the replacement bookkeeping.
+// pinned: the page was loaded by pinPage rather than prefetched. The caller holds poolLock
+static void frameLoaded(MgmtInfo *mgmtData, int frameNum, bool pinned)
+{
+    __atomic_store_n(&mgmtData->frames[frameNum].referenced, true, __ATOMIC_RELAXED);
+    lfuInsert(mgmtData, frameNum);
+    if (pinned)
+        lfuCountPin(mgmtData);
+    lrukRecall(mgmtData, frameNum, mgmtData->frames[frameNum].pageNum);
+    if (pinned)
+        lrukReference(mgmtData, frameNum);
+    listLoaded(mgmtData, frameNum);
+    arcLoaded(mgmtData, frameNum, pinned);
+}
+
+// The page in frame frameNum is being evicted: take it out of the replacement bookkeeping,
+// remembering it where the strategy keeps a history. The caller holds poolLock
+static void frameEvicted(MgmtInfo *mgmtData, int frameNum)
+{
+    lfuUnlink(mgmtData, frameNum);
+    lrukHeapRemove(mgmtData, frameNum);
+    lrukRemember(mgmtData, frameNum);
+    arcEvict(mgmtData, frameNum);
+    listUnlink(mgmtData, frameNum);
+}
+
+// Write the page in frame frameNum to disk under the pool's sync policy. The dirty flag is cleared before
+// the write, so a markDirty while it runs is not lost; it is set again if the write fails
+static RC writeFrame(MgmtInfo *mgmtData, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    setDirty(mgmtData, frame, false);
+
+    RC rc = writeBlock(frame->pageNum, &mgmtData->fh, frame->data);
+
+    if (rc != RC_OK)
+        setDirty(mgmtData, frame, true);
+    else
+        COUNT(mgmtData->writeIO);
+    return rc;
+}
+
+// Ask the background writer for a round now
+static void wakeWriter(MgmtInfo *mgmtData)
+{
+    pthread_mutex_lock(&mgmtData->writerLock);
+    mgmtData->writerWake = true;
+    pthread_cond_signal(&mgmtData->writerCond);
+    pthread_mutex_unlock(&mgmtData->writerLock);
+}
+
+// Claim a frame if it has no pins: pin it, latch it exclusively and mark it busy.
+// Clients release the latch before their pin, so the latch of a frame without pins is free
+static bool claimUnpinned(PageFrame *frame)
+{
+    if (FIX_COUNT(frame) != 0 || pthread_rwlock_trywrlock(&frame->latch) != 0)
+        return false;
+    __atomic_store_n(&frame->fixCount, 1, __ATOMIC_RELEASE);
+    SET_BUSY(frame, true);
+    return true;
+}
+
+// Choose a frame for page pageNum: an empty frame, otherwise the victim of the replacement strategy.
+// The frame is returned pinned (fix count 1), busy and latched exclusively, still holding its old page.
+// A clean old page has already left the replacement bookkeeping, a dirty one leaves it once it is written back.
+// Returns -1 if every frame is pinned
+static int claimVictim(BM_BufferPool *const bm, PageNumber pageNum)
+{
+    MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
+    PageFrame *frames = mgmtData->frames;
+    int frameNum = -1;
+
+    pthread_mutex_lock(&mgmtData->poolLock);
+    applyEvents(mgmtData);
+    arcMiss(mgmtData, pageNum, bm->numPages);
+
+    // Nobody can pin an empty frame, so an empty frame without pins is free to take. Only claimers,
+    // serialized by poolLock, change the page of a frame, and they hold a pin while they do.
+    // An entry is dropped if CLOCK has chosen the frame as its victim meanwhile, or if it is pinned (see unpinFrame)
+    while (frameNum == -1 && mgmtData->numFreeFrames > 0)
+    {
+        int i = mgmtData->freeFrames[--mgmtData->numFreeFrames];
+        frames[i].freeListed = false;
+        if (FIX_COUNT(&frames[i]) == 0 && PAGE_NUM(&frames[i]) == NO_PAGE && claimUnpinned(&frames[i]))
+            frameNum = i;
+    }
+
+    // The victim was unpinned when the strategy chose it; the partition lock makes sure it still is
+    for (int attempt = 0; frameNum == -1 && attempt < 2 * bm->numPages; attempt++)
+    {
+        int victim = findFrameToReplace(bm);
+        if (victim == -1)
+            break;
+
+        PagePartition *part = partitionOf(mgmtData, frames[victim].pageNum);
+        pthread_mutex_lock(&part->lock);
+        if (claimUnpinned(&frames[victim]))
+            frameNum = victim;
+        pthread_mutex_unlock(&part->lock);
+
+        // Pinned after the choice: LRU and LRU-K only hold unpinned frames, its pinner no longer expects it there
+        if (frameNum == -1)
+        {
+            if (mgmtData->listMode == LIST_LRU)
+                listUnlink(mgmtData, victim);
+            lrukHeapRemove(mgmtData, victim);
+        }
+    }
+
+    if (frameNum != -1)
+    {
+        arcClaimed(mgmtData, frameNum);
+        if (frames[frameNum].pageNum != NO_PAGE && !IS_DIRTY(&frames[frameNum]))
+            frameEvicted(mgmtData, frameNum);
+    }
+    pthread_mutex_unlock(&mgmtData->poolLock);
+    return frameNum;
+}
+
+// Frame frameNum, claimed by this thread, ends up empty: it no longer maps a page and its pin and latch are released
+static void abandonFrame(MgmtInfo *mgmtData, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    if (frame->pageNum != NO_PAGE)
+    {
+        PagePartition *part = partitionOf(mgmtData, frame->pageNum);
+        pthread_mutex_lock(&part->lock);
+        removeFrame(mgmtData, part, frameNum);
+        SET_PAGE_NUM(frame, NO_PAGE);
+        pthread_mutex_unlock(&part->lock);
+    }
+    setDirty(mgmtData, frame, false);
+    SET_BUSY(frame, false);
+    pthread_rwlock_unlock(&frame->latch);
+    unpinFrame(mgmtData, frameNum);
+}
+
+// Take a frame for page pageNum and map the page to it, so the page can be read into it. A dirty victim
+// is written back first; until then its old page stays mapped and its pins wait for the latch.
+// On RC_OK *frameNum is the frame, pinned, busy and latched exclusively, or -1 if every frame is pinned
+// or another thread has cached pageNum meanwhile (then *cachedMeanwhile is set; that thread's frame
+// may be evicted again before the caller looks for it). Other return codes are write back errors
+static RC claimFrame(BM_BufferPool *const bm, PageNumber pageNum, int *frameNum, bool *cachedMeanwhile)
+{
+    MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
+    *frameNum = -1;
+    *cachedMeanwhile = false;
+
+    int claimed = claimVictim(bm, pageNum);
+    if (claimed == -1)
+        return RC_OK;
+
+    PageFrame *frame = &mgmtData->frames[claimed];
+    if (frame->pageNum != NO_PAGE && IS_DIRTY(frame))
+    {
+        // The writer did not keep up with the misses
+        if (mgmtData->hasWriter)
+            wakeWriter(mgmtData);
+
+        RC rc = writeFrame(mgmtData, claimed);
+        if (rc != RC_OK)
+        {
+            // The old page stays cached; unpinFrame gives it back to LRU and LRU-K
+            SET_BUSY(frame, false);
+            pthread_rwlock_unlock(&frame->latch);
+            unpinFrame(mgmtData, claimed);
+            return rc;
+        }
+        pthread_mutex_lock(&mgmtData->poolLock);
+        frameEvicted(mgmtData, claimed);
+        pthread_mutex_unlock(&mgmtData->poolLock);
+    }
+
+    if (frame->pageNum != NO_PAGE)
+    {
+        PagePartition *part = partitionOf(mgmtData, frame->pageNum);
+        pthread_mutex_lock(&part->lock);
+        removeFrame(mgmtData, part, claimed);
+        SET_PAGE_NUM(frame, NO_PAGE);
+        pthread_mutex_unlock(&part->lock);
+    }
+
+    PagePartition *part = partitionOf(mgmtData, pageNum);
+    pthread_mutex_lock(&part->lock);
+    bool cached = partitionFind(mgmtData, part, pageNum) != -1;
+    if (!cached)
+    {
+        SET_PAGE_NUM(frame, pageNum);
+        if (!insertFrame(mgmtData, part, claimed))
+        {
+            SET_PAGE_NUM(frame, NO_PAGE);
+            pthread_mutex_unlock(&part->lock);
+            abandonFrame(mgmtData, claimed);
+            return RC_ERROR;
+        }
+    }
+    pthread_mutex_unlock(&part->lock);
+
+    if (cached)
+    {
+        abandonFrame(mgmtData, claimed);
+        *cachedMeanwhile = true;
+        return RC_OK;
+    }
+    setDirty(mgmtData, frame, false);
+    *frameNum = claimed;
+    return RC_OK;
+}
+
+// The page was read into claimed frame frameNum: enter it into the replacement bookkeeping and let the
+// pins waiting for it go on. The claim's pin and latch stay with the caller
+static void finishLoad(MgmtInfo *mgmtData, int frameNum, bool pinned)
+{
+    COUNT(mgmtData->readIO);
+    pthread_mutex_lock(&mgmtData->poolLock);
+    applyEvents(mgmtData);
+    frameLoaded(mgmtData, frameNum, pinned);
+    pthread_mutex_unlock(&mgmtData->poolLock);
+    SET_BUSY(&mgmtData->frames[frameNum], false);
+}
+
+static void latchFrame(PageFrame *frame, BM_LatchMode mode)
+{
+    if (mode == BM_LATCH_SHARED)
+        pthread_rwlock_rdlock(&frame->latch);
+    else if (mode == BM_LATCH_EXCLUSIVE)
+        pthread_rwlock_wrlock(&frame->latch);
+}
+
+static void unlatchFrame(PageFrame *frame, BM_LatchMode mode)
+{
+    if (mode != BM_LATCH_NONE)
+        pthread_rwlock_unlock(&frame->latch);
+}
+
+// Pin frame frameNum for a flush if it holds a dirty page nobody has pinned, so the page is not evicted
+// before it is written (flushFrames latches it for the write). Returns true if the frame was taken
+static bool pinForFlush(MgmtInfo *mgmtData, int frameNum)
+{
+    PageFrame *frame = &mgmtData->frames[frameNum];
+    PageNumber pageNum = PAGE_NUM(frame);
+    if (!IS_DIRTY(frame) || FIX_COUNT(frame) != 0 || pageNum == NO_PAGE)
+        return false;
+
+    bool pinned = false;
+    PagePartition *part = partitionOf(mgmtData, pageNum);
+    pthread_mutex_lock(&part->lock);
+    if (partitionFind(mgmtData, part, pageNum) == frameNum && FIX_COUNT(frame) == 0)
+    {
+        __atomic_fetch_add(&frame->fixCount, 1, __ATOMIC_ACQ_REL);
+        pinned = true;
+    }
+    pthread_mutex_unlock(&part->lock);
+    return pinned;
+}
+
+// Write the pages of the numDirty frames in dirty, taken with pinForFlush, and release the frames.
+// Each run of adjacent pages is latched shared, so it does not change while it is written, and released
+// right after its write. A page a client has latched exclusively since is being changed and stays dirty;
+// waiting for it could deadlock. The pages become durable together with one sync at the end
+static RC flushFrames(MgmtInfo *mgmtData, PageFrame **dirty, int numDirty)
+{
+    PageFrame *frames = mgmtData->frames;
+    if (numDirty == 0)
+        return RC_OK;
+
+    // Write the dirty pages in page number order, so each run of adjacent pages is a single vectored write
+    qsort(dirty, numDirty, sizeof(PageFrame *), comparePageNum);
+
+    SM_PageHandle *pages = malloc(sizeof(SM_PageHandle) * numDirty);
+    if (pages == NULL)
+    {
+        for (int i = 0; i < numDirty; i++)
+        {
+            unpinFrame(mgmtData, (int)(dirty[i] - frames));
+        }
+        return RC_ERROR;
+    }
+
+    // The runs are written without syncing, one sync at the end makes the whole flush durable.
+    // Other writes keep the sync policy of the pool
+    RC rc = RC_OK;
+    int next = 0;
+    while (next < numDirty && rc == RC_OK)
+    {
+        // Latch the frames of the next run, moving them to dirty[runStart..]; a frame that cannot be latched
+        // or was written meanwhile is released and ends the run
+        int runStart = next;
+        int runLength = 0;
+        while (next < numDirty && runLength < BM_FLUSH_RUN_PAGES &&
+               (runLength == 0 || dirty[next]->pageNum == dirty[runStart]->pageNum + runLength))
+        {
+            PageFrame *frame = dirty[next++];
+            bool latched = (pthread_rwlock_tryrdlock(&frame->latch) == 0);
+            if (latched && !IS_DIRTY(frame))
+            {
+                pthread_rwlock_unlock(&frame->latch);
+                latched = false;
+            }
+            if (!latched)
+            {
+                unpinFrame(mgmtData, (int)(frame - frames));
+                if (runLength > 0)
+                    break;
+                runStart = next;
+                continue;
+            }
+            dirty[runStart + runLength] = frame;
+            pages[runLength++] = frame->data;
+        }
+        if (runLength == 0)
+            continue;
+
+        // The dirty flags are cleared before the write, a markDirty while it runs stays
+        for (int i = runStart; i < runStart + runLength; i++)
+        {
+            setDirty(mgmtData, dirty[i], false);
+        }
+        rc = writeBlockRangeSync(dirty[runStart]->pageNum, runLength, &mgmtData->fh, pages, SM_SYNC_NONE);
+        if (rc == RC_OK)
+        {
+            __atomic_fetch_add(&mgmtData->writeIO, runLength, __ATOMIC_RELAXED);
+        }
+        for (int i = runStart; i < runStart + runLength; i++)
+        {
+            if (rc != RC_OK)
+                setDirty(mgmtData, dirty[i], true);
+            pthread_rwlock_unlock(&dirty[i]->latch);
+            unpinFrame(mgmtData, (int)(dirty[i] - frames));
+        }
+    }
 
-// Function to find a frame to replace based on the replacement strategy
-extern int findFrameToReplace(BM_BufferPool *bm) 
+    // The frames not reached after a write error stay dirty
+    for (; next < numDirty; next++)
+    {
+        unpinFrame(mgmtData, (int)(dirty[next] - frames));
+    }
+    free(pages);
+
+    // The sync needs no latches: pages changed since their write are dirty again and written by a later flush
+    if (mgmtData->syncPolicy != SM_SYNC_NONE && rc == RC_OK)
+        rc = syncPageFile(&mgmtData->fh);
+    return rc;
+}
+
+// Collect up to limit unpinned frames holding pages into cold, in the order the replacement strategy is going
+// to evict them, without changing its state. Returns their number. The caller holds poolLock
+static int coldFrames(BM_BufferPool *bm, int limit, int *cold)
 {
     MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
-    PageFrame *frames = (PageFrame *)mgmtData->frames;
-    switch (bm->strategy) {
+    PageFrame *frames = mgmtData->frames;
+    int numCold = 0;
+
+#define ADD_COLD(i) \
+    if (numCold < limit && FIX_COUNT(&frames[i]) == 0 && PAGE_NUM(&frames[i]) != NO_PAGE) \
+        cold[numCold++] = (i)
+
+    switch (bm->strategy)
+    {
         case RS_FIFO:
-        // FIFO strategy: find the frame with the lowest lastUsed value
+        case RS_LRU:
+            for (int i = mgmtData->list.oldest; i != -1 && numCold < limit; i = frames[i].listPrev)
             {
-                int lastUsed = getNumReadIO(bm);
-                int lastUsedIndex = -1;
-
-                for (int i = 0; i < bm->numPages; i++) 
+                ADD_COLD(i);
+            }
+            break;
+        case RS_CLOCK:
+        // The frames in the order the hand reaches them, their reference bits only delay some of them
+            for (int step = 0; step < bm->numPages && numCold < limit; step++)
+            {
+                ADD_COLD((mgmtData->clockHand + step) % bm->numPages);
+            }
+            break;
+        case RS_LFU:
+            for (int b = mgmtData->lfuFirst; b != -1 && numCold < limit; b = mgmtData->lfuBuckets[b].next)
+            {
+                for (int i = mgmtData->lfuBuckets[b].tail; i != -1 && numCold < limit; i = frames[i].lfuPrev)
                 {
-                    if (frames[i].fixCount == 0) 
-                    {
-                        if (frames[i].lastUsed < lastUsed) 
-                        {
-                            lastUsed = frames[i].lastUsed;
-                            lastUsedIndex = i;
-                        }
-                    }
+                    ADD_COLD(i);
                 }
-
-                return lastUsedIndex;
             }
-        case RS_LRU:
-        // LRU strategy: find the frame with the lowest lruCount
+            break;
+        case RS_ARC:
             {
-                int lruCount = mgmtData->cacheHits;
-                int leastUsedIndex = -1;
-
-                for (int i = 0; i < bm->numPages; i++) 
+                bool fromT1 = arcPrefersT1(mgmtData);
+                FrameList *lists[2] = {fromT1 ? &mgmtData->arcT1 : &mgmtData->arcT2, fromT1 ? &mgmtData->arcT2 : &mgmtData->arcT1};
+                for (int l = 0; l < 2; l++)
                 {
-                    if (frames[i].fixCount == 0) 
+                    for (int i = lists[l]->oldest; i != -1 && numCold < limit; i = frames[i].listPrev)
                     {
-                        if (frames[i].lruCount < lruCount) 
-                        {
-                            lruCount = frames[i].lruCount;
-                            leastUsedIndex = i;
-                        }
+                        ADD_COLD(i);
                     }
                 }
-
-                return leastUsedIndex;
             }
+            break;
+        case RS_LRU_K:
+        // The heap in array order: the next victim first, every frame after the frames above it
+            for (int h = 0; h < mgmtData->lrukHeapSize && numCold < limit; h++)
+            {
+                ADD_COLD(mgmtData->lrukHeap[h]);
+            }
+            break;
         default:
-            return -1;
+            break;
     }
-    return -1;
+#undef ADD_COLD
+    return numCold;
+}
+
+// One round of the background writer: write back the dirty pages among the cleanTarget coldest frames, which
+// the strategy evicts next, so misses find them clean. Beyond the high water mark it takes all unpinned frames.
+// Write errors leave the pages dirty, the miss that evicts one of them reports the error
+static void writerRound(BM_BufferPool *bm)
+{
+    MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
+    bool pastHighWater = __atomic_load_n(&mgmtData->numDirty, __ATOMIC_RELAXED) > mgmtData->dirtyHighWater;
+    int limit = pastHighWater ? bm->numPages : mgmtData->cleanTarget;
+
+    int *cold = malloc(sizeof(int) * limit);
+    PageFrame **dirty = malloc(sizeof(PageFrame *) * limit);
+    if (cold != NULL && dirty != NULL)
+    {
+        pthread_mutex_lock(&mgmtData->poolLock);
+        applyEvents(mgmtData);
+        int numCold = coldFrames(bm, limit, cold);
+        pthread_mutex_unlock(&mgmtData->poolLock);
+
+        int numDirty = 0;
+        for (int i = 0; i < numCold; i++)
+        {
+            if (pinForFlush(mgmtData, cold[i]))
+                dirty[numDirty++] = &mgmtData->frames[cold[i]];
+        }
+        flushFrames(mgmtData, dirty, numDirty);
+    }
+    free(cold);
+    free(dirty);
+}
+
+// The background writer thread: a round every BM_WRITER_INTERVAL_MS, or sooner when one is asked for
+static void *runWriter(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
+
+    pthread_mutex_lock(&mgmtData->writerLock);
+    while (!mgmtData->writerStop)
+    {
+        if (!mgmtData->writerWake)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_nsec += BM_WRITER_INTERVAL_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&mgmtData->writerCond, &mgmtData->writerLock, &deadline);
+            if (mgmtData->writerStop)
+                break;
+        }
+        mgmtData->writerWake = false;
+        mgmtData->writerStarted++;
+        pthread_mutex_unlock(&mgmtData->writerLock);
+
+        writerRound(bm);
+
+        pthread_mutex_lock(&mgmtData->writerLock);
+        mgmtData->writerRounds++;
+        pthread_cond_broadcast(&mgmtData->writerDone);
+    }
+    pthread_mutex_unlock(&mgmtData->writerLock);
+    return NULL;
+}
+
+// Throttle a thread while too many frames are dirty: ask the writer for rounds until the dirty frames are back
+// under the high water mark. Only a round that starts after the wake counts, one already running may have
+// missed the newest dirty frames. Gives up when a round frees no frame (the dirty ones are pinned or fail to write)
+static void waitForWriter(MgmtInfo *mgmtData)
+{
+    pthread_mutex_lock(&mgmtData->writerLock);
+    int dirty = __atomic_load_n(&mgmtData->numDirty, __ATOMIC_RELAXED);
+    while (dirty > mgmtData->dirtyHighWater && !mgmtData->writerStop)
+    {
+        unsigned round = mgmtData->writerStarted + 1;
+        mgmtData->writerWake = true;
+        pthread_cond_signal(&mgmtData->writerCond);
+        while ((int)(mgmtData->writerRounds - round) < 0 && !mgmtData->writerStop)
+            pthread_cond_wait(&mgmtData->writerDone, &mgmtData->writerLock);
+
+        int before = dirty;
+        dirty = __atomic_load_n(&mgmtData->numDirty, __ATOMIC_RELAXED);
+        if (dirty >= before)
+            break;
+    }
+    pthread_mutex_unlock(&mgmtData->writerLock);
 }
 
 // Function to initialize the buffer pool
 extern RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
                   const int numPages, ReplacementStrategy strategy, void *stratData) 
+{
+    return initBufferPoolWithOptions(bm, pageFileName, numPages, strategy, stratData, NULL);
+}
+
+// Function to initialize the buffer pool with additional options (NULL options gives the defaults)
+extern RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName, 
+                  const int numPages, ReplacementStrategy strategy, void *stratData,
+                  const BM_PoolOptions *options) 
 {
     // Check for invalid input parameters
     if (bm == NULL || pageFileName == NULL || numPages <= 0)
         return RC_ERROR;
 
+    // The frames are as large as the pages of the file, so the file has to exist already.
+    // It stays open until shutdownBufferPool, every read and write of the pool goes through this handle
+    int openFlags = (options != NULL) ? options->openFlags : SM_OPEN_DEFAULT;
+    int syncPolicy = (options != NULL) ? options->syncPolicy : SM_SYNC_NONE;
+    SM_FileHandle fh;
+    RC rc = openPageFileFlags((char *)pageFileName, &fh, openFlags);
+    if (rc != RC_OK)
+        return rc;
+    rc = setSyncPolicy(&fh, syncPolicy, 0, 0);
+    if (rc != RC_OK)
+    {
+        closePageFile(&fh);
+        return rc;
+    }
+    int pageSize = fh.pageSize;
+
     // Set buffer pool properties
     bm->pageFile = (char *)pageFileName;
     bm->numPages = numPages;
+    bm->pageSize = pageSize;
     bm->strategy = strategy;
 
-    // Allocate memory for page frames
+    // Allocate memory for page frames, and the memory of their pages in one piece
     PageFrame *frames = calloc(numPages, sizeof(PageFrame));
     if (frames == NULL)
+    {
+        closePageFile(&fh);
+        return RC_ERROR;
+    }
+    size_t arenaSize;
+    char *arena = mapFrameArena((size_t)numPages * pageSize, options != NULL && options->hugePages, &arenaSize);
+    if (arena == NULL)
+    {
+        free(frames);
+        closePageFile(&fh);
         return RC_ERROR;
+    }
 
     // Initialize page frames
     for (int i = 0; i < numPages; i++) 
     {
         frames[i].pageNum = NO_PAGE;
-        frames[i].data = NULL;
+        frames[i].data = arena + (size_t)i * pageSize;
         frames[i].isDirty = false;
         frames[i].fixCount = 0;
-        frames[i].lastUsed = 0;
+        frames[i].busy = false;
+        pthread_rwlock_init(&frames[i].latch, NULL);
+        frames[i].list = NULL;
+        frames[i].referenced = false;
+        frames[i].lfuBucket = -1;
+        frames[i].lrukLast = 0;
+        frames[i].heapPos = -1;
+    }
+
+    // LFU keeps a bucket node per frame and a spare one (see lfuTouch)
+    LFUBucket *lfuBuckets = NULL;
+    if (strategy == RS_LFU)
+    {
+        lfuBuckets = malloc(sizeof(LFUBucket) * (numPages + 1));
+        if (lfuBuckets == NULL)
+        {
+            munmap(arena, arenaSize);
+            free(frames);
+            closePageFile(&fh);
+            return RC_ERROR;
+        }
+        for (int i = 0; i <= numPages; i++)
+            lfuBuckets[i].next = (i < numPages) ? i + 1 : -1;
+    }
+
+    // Each partition of the page table starts with at least twice as many slots as its share of the frames,
+    // so probe sequences stay short; a partition that gets more than its share grows
+    int partitionSize = 4;
+    while (partitionSize < 2 * (numPages / BM_PARTITIONS + 1))
+        partitionSize <<= 1;
+    PagePartition *partitions = NULL;
+    bool tableMade = posix_memalign((void **)&partitions, sizeof(PagePartition), sizeof(PagePartition) * BM_PARTITIONS) == 0;
+    for (int p = 0; tableMade && p < BM_PARTITIONS; p++)
+    {
+        partitions[p].slots = malloc(sizeof(int) * partitionSize);
+        partitions[p].mask = partitionSize - 1;
+        partitions[p].count = 0;
+        pthread_mutex_init(&partitions[p].lock, NULL);
+        for (int i = 0; partitions[p].slots != NULL && i < partitionSize; i++)
+            partitions[p].slots[i] = -1;
+        tableMade = partitions[p].slots != NULL;
     }
 
     // Initialize management data
-    MgmtInfo *mgmtData = malloc(sizeof(MgmtInfo));
+    MgmtInfo *mgmtData = calloc(1, sizeof(MgmtInfo));
+    int *freeFrames = malloc(sizeof(int) * numPages);
+    bool loggedHits = strategy != RS_FIFO && strategy != RS_CLOCK;
+    FrameEvent *events = loggedHits ? calloc(BM_EVENT_RING, sizeof(FrameEvent)) : NULL;
+    if (!tableMade || mgmtData == NULL || freeFrames == NULL || (loggedHits && events == NULL) || (strategy == RS_LRU_K && !initLRUK(mgmtData, numPages, stratData)) ||
+        (strategy == RS_ARC && !initARC(mgmtData, numPages)))
+    {
+        for (int p = 0; partitions != NULL && p < BM_PARTITIONS; p++)
+            free(partitions[p].slots);
+        free(partitions);
+        free(mgmtData);
+        free(freeFrames);
+        free(events);
+        free(lfuBuckets);
+        munmap(arena, arenaSize);
+        free(frames);
+        closePageFile(&fh);
+        return RC_ERROR;
+    }
+    mgmtData->fh = fh;
     mgmtData->frames = frames;
+    mgmtData->arena = arena;
+    mgmtData->arenaSize = arenaSize;
+    mgmtData->partitions = partitions;
+    mgmtData->freeFrames = freeFrames;
+    mgmtData->numFreeFrames = 0;
+    for (int i = numPages - 1; i >= 0; i--)     // frame 0 on top, frames fill in order
+        pushFreeFrame(mgmtData, i);
+    mgmtData->loggedHits = loggedHits;
+    mgmtData->events = events;
+    mgmtData->eventTail = 0;
+    mgmtData->eventHead = 0;
+    pthread_mutex_init(&mgmtData->poolLock, NULL);
+    pthread_mutex_init(&mgmtData->fileLock, NULL);
+    mgmtData->listMode = (strategy == RS_FIFO) ? LIST_FIFO : (strategy == RS_LRU) ? LIST_LRU : LIST_NONE;
+    mgmtData->list = (FrameList){.newest = -1, .oldest = -1, .size = 0};
+    mgmtData->clockHand = 0;
+    mgmtData->lfuBuckets = lfuBuckets;
+    mgmtData->lfuFirst = -1;
+    mgmtData->lfuFreeBucket = 0;
+    mgmtData->lfuAgingInterval = (strategy == RS_LFU && stratData != NULL) ? *(const int *)stratData : 0;
+    mgmtData->lfuPins = 0;
     mgmtData->readIO = 0;
     mgmtData->writeIO = 0;
     mgmtData->cacheHits = 0;
+    mgmtData->pinRequests = 0;
+    mgmtData->syncPolicy = syncPolicy;
+    mgmtData->numDirty = 0;
 
     bm->mgmtData = mgmtData;
 
+    // The background writer, if asked for, keeps options->cleanFrames percent of the frames clean
+    int cleanFrames = (options != NULL) ? options->cleanFrames : 0;
+    if (cleanFrames > 0)
+    {
+        int highWater = (options->dirtyHighWater > 0) ? options->dirtyHighWater : BM_DIRTY_HIGH_WATER;
+        mgmtData->cleanTarget = (int)(((long)numPages * (cleanFrames < 100 ? cleanFrames : 100) + 99) / 100);
+        mgmtData->dirtyHighWater = (int)((long)numPages * (highWater < 100 ? highWater : 100) / 100);
+
+        pthread_condattr_t condAttr;
+        pthread_condattr_init(&condAttr);
+        pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+        pthread_mutex_init(&mgmtData->writerLock, NULL);
+        pthread_cond_init(&mgmtData->writerCond, &condAttr);
+        pthread_cond_init(&mgmtData->writerDone, NULL);
+        pthread_condattr_destroy(&condAttr);
+        if (pthread_create(&mgmtData->writer, NULL, runWriter, bm) != 0)
+        {
+            pthread_mutex_destroy(&mgmtData->writerLock);
+            pthread_cond_destroy(&mgmtData->writerCond);
+            pthread_cond_destroy(&mgmtData->writerDone);
+            shutdownBufferPool(bm);
+            return RC_ERROR;
+        }
+        mgmtData->hasWriter = true;
+    }
+
     return RC_OK;
 }
 
-// Function to shut down the buffer pool
+// Function to shut down the buffer pool, no other thread may use it any more
 extern RC shutdownBufferPool(BM_BufferPool *const bm) 
 {
     // Check for invalid input
@@ -128,23 +1938,73 @@ extern RC shutdownBufferPool(BM_BufferPool *const bm)
     MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
     PageFrame *frames = (PageFrame *)mgmtData->frames;
 
-    // Force flush all pages
-    RC rc = forceFlushPool(bm);
-    if (rc != RC_OK) 
+    // Hold the background writer between rounds, so the pins it takes for its writes are not mistaken
+    // for pinned pages. It cannot start another round while writerLock is held
+    if (mgmtData->hasWriter)
     {
-        return rc;
+        pthread_mutex_lock(&mgmtData->writerLock);
+        while (mgmtData->writerRounds != mgmtData->writerStarted)
+            pthread_cond_wait(&mgmtData->writerDone, &mgmtData->writerLock);
     }
 
-    // Check for pinned pages and free memory
-    for (int i = 0; i < bm->numPages; i++) 
+    // Check for pinned pages before flushing or freeing anything, then force flush all pages.
+    // A pool that cannot be shut down goes on as before, with its writer
+    RC rc = RC_OK;
+    for (int i = 0; i < bm->numPages && rc == RC_OK; i++) 
     {
         if (frames[i].fixCount != 0) 
         {
-            return RC_PINNED_PAGES_IN_BUFFER; // Error: there are still pinned pages
+            rc = RC_PINNED_PAGES_IN_BUFFER; // Error: there are still pinned pages
+        }
+    }
+    if (rc == RC_OK)
+    {
+        rc = forceFlushPool(bm);
+    }
+    if (mgmtData->hasWriter)
+    {
+        if (rc == RC_OK)
+        {
+            mgmtData->writerStop = true;
+            pthread_cond_signal(&mgmtData->writerCond);
         }
-        free(frames[i].data);
+        pthread_mutex_unlock(&mgmtData->writerLock);
+    }
+    if (rc != RC_OK) 
+    {
+        return rc;
+    }
+
+    // The shutdown goes through, stop the background writer
+    if (mgmtData->hasWriter)
+    {
+        pthread_join(mgmtData->writer, NULL);
+        pthread_mutex_destroy(&mgmtData->writerLock);
+        pthread_cond_destroy(&mgmtData->writerCond);
+        pthread_cond_destroy(&mgmtData->writerDone);
+        mgmtData->hasWriter = false;
+    }
+    for (int i = 0; i < bm->numPages; i++) 
+    {
+        pthread_rwlock_destroy(&frames[i].latch);
+    }
+    for (int p = 0; p < BM_PARTITIONS; p++)
+    {
+        pthread_mutex_destroy(&mgmtData->partitions[p].lock);
+        free(mgmtData->partitions[p].slots);
     }
+    free(mgmtData->partitions);
+    pthread_mutex_destroy(&mgmtData->poolLock);
+    pthread_mutex_destroy(&mgmtData->fileLock);
+    munmap(mgmtData->arena, mgmtData->arenaSize);
     free(frames);
+    free(mgmtData->freeFrames);
+    free(mgmtData->events);
+    closePageFile(&mgmtData->fh);
+    free(mgmtData->lfuBuckets);
+    freeLRUK(mgmtData);
+    freeARC(mgmtData);
+    free(mgmtData);
 
     bm->mgmtData = NULL;
 
@@ -163,20 +2023,22 @@ extern RC forceFlushPool(BM_BufferPool *const bm)
     MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
     PageFrame *frames = (PageFrame *)mgmtData->frames;
 
-    // Iterate through all frames and flush dirty pages
+    // Collect all dirty, unpinned frames (see pinForFlush) and write them
+    PageFrame **dirty = malloc(sizeof(PageFrame *) * bm->numPages);
+    if (dirty == NULL)
+        return RC_ERROR;
+
+    int numDirty = 0;
     for (int i = 0; i < bm->numPages; i++) 
     {
-        if (frames[i].isDirty && frames[i].fixCount == 0) 
+        if (pinForFlush(mgmtData, i))
         {
-            SM_FileHandle fh;
-            RC rc = openPageFile(bm->pageFile, &fh);
-
-            rc = writeBlock(frames[i].pageNum, &fh, frames[i].data);
-            mgmtData->writeIO++;
-            frames[i].isDirty = false;
+            dirty[numDirty++] = &frames[i];
         }
     }
-    return RC_OK;
+    RC rc = flushFrames(mgmtData, dirty, numDirty);
+    free(dirty);
+    return rc;
 }
 
 // Function to mark a page as dirty
@@ -192,19 +2054,23 @@ extern RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
     PageFrame *frames = (PageFrame *)mgmtData->frames;
 
     // Find the page in the buffer and mark it as dirty
-    for (int i = 0; i < bm->numPages; i++) 
+    int frameNum = lookupFrame(mgmtData, page->pageNum);
+    if (frameNum == -1)
     {
-        if (frames[i].pageNum == page->pageNum) 
-        {
-            frames[i].isDirty = true;
-            return RC_OK;
-        }
+        return RC_ERROR;
     }
-    return RC_ERROR;
+    setDirty(mgmtData, &frames[frameNum], true);
+    return RC_OK;
 }
 
 // Function to unpin a page
 extern RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page) 
+{
+    return unpinPageLatched(bm, page, BM_LATCH_NONE);
+}
+
+// Function to unpin a page pinned with pinPageLatched, releasing the latch taken in mode
+extern RC unpinPageLatched(BM_BufferPool *const bm, BM_PageHandle *const page, BM_LatchMode mode) 
 {
     // Check for invalid input
     if (bm == NULL || bm->mgmtData == NULL || page == NULL) 
@@ -216,22 +2082,23 @@ extern RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page)
     PageFrame *frames = (PageFrame *)mgmtData->frames;
 
     // Find the page in the buffer and decrement its fix count
-    for (int i = 0; i < bm->numPages; i++) 
+    int frameNum = lookupFrame(mgmtData, page->pageNum);
+    if (frameNum == -1)
     {
-        if (frames[i].pageNum == page->pageNum) 
-        {
-            if (frames[i].fixCount > 0) 
-            {
-                frames[i].fixCount--;
-                return RC_OK;
-            } 
-            else 
-            {
-                return RC_ERROR;  // Page is already unpinned, this might be an error condition
-            }
-        }
+        return RC_ERROR;
+    }
+    if (FIX_COUNT(&frames[frameNum]) == 0)
+    {
+        return RC_ERROR;  // Page is already unpinned, this might be an error condition
     }
-    return RC_ERROR;
+    // The latch goes before the pin: a frame without pins is never latched
+    unlatchFrame(&frames[frameNum], mode);
+    unpinFrame(mgmtData, frameNum);
+
+    // Past the high water mark of dirty frames, threads wait for the writer before they go on
+    if (mgmtData->hasWriter && __atomic_load_n(&mgmtData->numDirty, __ATOMIC_RELAXED) > mgmtData->dirtyHighWater)
+        waitForWriter(mgmtData);
+    return RC_OK;
 }
 
 // Function to force a page to disk
@@ -245,32 +2112,37 @@ extern RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page)
     MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
     PageFrame *frames = (PageFrame *)mgmtData->frames;
 
-    //Open the page file
-    SM_FileHandle fh;
-    RC rc = openPageFile(bm->pageFile, &fh);
-    if (rc != RC_OK)
-        return rc;
-    
-    // Find the page in the buffer and write it to disk
-    for (int i = 0; i < bm->numPages; i++) 
+    // Find the page in the buffer and pin it, so it is not evicted while it is written
+    int frameNum = pinCached(mgmtData, page->pageNum);
+    if (frameNum == -1)
     {
-        if (frames[i].pageNum == page->pageNum) 
-        {
-            rc = writeBlock(page->pageNum, &fh, page->data);
-            if (rc == RC_OK) 
-            {
-                frames[i].isDirty = false;
-            }
-            mgmtData->writeIO++;
-            closePageFile(&fh);
-            return rc;
-        }
+        return RC_ERROR;
+    }
+    if (IS_BUSY(&frames[frameNum]))
+    {
+        pthread_rwlock_rdlock(&frames[frameNum].latch);
+        pthread_rwlock_unlock(&frames[frameNum].latch);
     }
-    return RC_ERROR;
+
+    // Write the page to disk, synced as the pool's sync policy asks
+    RC rc = RC_ERROR;
+    if (!IS_BUSY(&frames[frameNum]) && frames[frameNum].pageNum == page->pageNum) 
+    {
+        rc = writeFrame(mgmtData, frameNum);
+    }
+    unpinFrame(mgmtData, frameNum);
+    return rc;
 }
 
 // Funtion to Pin page
 extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) 
+{
+    return pinPageLatched(bm, page, pageNum, BM_LATCH_NONE);
+}
+
+// Function to pin a page and latch it in mode until unpinPageLatched
+extern RC pinPageLatched(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum,
+                         BM_LatchMode mode) 
 {
     // Check for invalid input
     if (bm == NULL || bm->mgmtData == NULL || page == NULL) {
@@ -279,85 +2151,151 @@ extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const Page
 
     MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
     PageFrame *frames = (PageFrame *)mgmtData->frames;
+    COUNT(mgmtData->pinRequests);
 
-    // If the page is already in the buffer, update its metadata
-    for (int i = 0; i < bm->numPages; i++) 
+    for (;;)
     {
-        if (frames[i].pageNum == pageNum) 
+        // If the page is already in the buffer, pin it and update its metadata. A busy frame is still being
+        // read in or evicted: wait for its latch, then the frame either holds the page or has lost it
+        int cachedFrame = pinCached(mgmtData, pageNum);
+        if (cachedFrame != -1) 
         {
-            page->pageNum = pageNum;
-            page->data = frames[i].data;
-            frames[i].fixCount++;
-            mgmtData->cacheHits++;
-            if(bm->strategy == RS_LRU)
+            PageFrame *frame = &frames[cachedFrame];
+            latchFrame(frame, mode);
+            if (mode == BM_LATCH_NONE && IS_BUSY(frame))
+            {
+                pthread_rwlock_rdlock(&frame->latch);
+                pthread_rwlock_unlock(&frame->latch);
+            }
+            if (!IS_BUSY(frame) && frame->pageNum == pageNum)
             {
-                frames[i].lruCount = mgmtData->cacheHits; // Update for LRU
+                page->pageNum = pageNum;
+                page->data = frame->data;
+                frameHit(mgmtData, cachedFrame);
+                COUNT(mgmtData->cacheHits);
+                return RC_OK;
             }
-            return RC_OK;
+            unlatchFrame(frame, mode);
+            unpinFrame(mgmtData, cachedFrame);
+            continue;
         }
-    }
 
-    // Page not in buffer pool, find an empty frame or use replacement strategy
-    int frameNum = -1;
-    for (int i = 0; i < bm->numPages; i++) 
-    {
-        if (frames[i].pageNum == NO_PAGE) 
+        // Page not in buffer pool: grow the file to hold it if needed
+        pthread_mutex_lock(&mgmtData->fileLock);
+        RC rc = ensureCapacity(pageNum + 1, &mgmtData->fh);
+        pthread_mutex_unlock(&mgmtData->fileLock);
+        if (rc != RC_OK) return rc;
+
+        // Find an empty frame or use replacement strategy, the page is pinned in the pool from now on.
+        // If another thread has loaded it meanwhile, pin that, or miss again if it is gone already
+        int frameNum;
+        bool cachedMeanwhile;
+        rc = claimFrame(bm, pageNum, &frameNum, &cachedMeanwhile);
+        if (rc != RC_OK) return rc;
+        if (frameNum == -1)
         {
-            frameNum = i;
-            break;
+            if (cachedMeanwhile || lookupFrame(mgmtData, pageNum) != -1) continue;
+            return RC_ERROR;
         }
-    }
 
-    // If no empty frame, use replacement strategy to Find a frame to replace
-    if (frameNum == -1)
-    {
-        frameNum = findFrameToReplace(bm);
+        // Read the page from disk into the frame's memory in the arena; if that fails the frame stays empty
+        rc = readBlock(pageNum, &mgmtData->fh, frames[frameNum].data);
+        if (rc != RC_OK)
+        {
+            abandonFrame(mgmtData, frameNum);
+            return rc;
+        }
+        finishLoad(mgmtData, frameNum, true);
+        if (mode != BM_LATCH_EXCLUSIVE)
+        {
+            pthread_rwlock_unlock(&frames[frameNum].latch);
+            latchFrame(&frames[frameNum], mode);
+        }
+
+        // Set page handle information
+        page->pageNum = pageNum;
+        page->data = frames[frameNum].data;
+
+        return RC_OK;
     }
-    if (frameNum == -1) {
+}
+
+
+// Load up to numPages adjacent pages starting at startPage into the pool with one vectored read,
+// without pinning them. Pages that are already cached end the run, pages past the end of the
+// file are not prefetched, and at most half of the pool is used so the caller's own pages stay cached.
+extern RC prefetchPages(BM_BufferPool *const bm, const PageNumber startPage, const int numPages)
+{
+    // Check for invalid input
+    if (bm == NULL || bm->mgmtData == NULL || startPage < 0 || numPages <= 0) {
         return RC_ERROR;
     }
-    
-    // If the frame to be replaced is dirty, write it to disk
-    if (frames[frameNum].isDirty) 
+
+    MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
+    PageFrame *frames = (PageFrame *)mgmtData->frames;
+
+    int maxPages = numPages;
+    if (maxPages > bm->numPages / 2)
+        maxPages = bm->numPages / 2;
+    if (maxPages <= 0)
+        return RC_OK;
+
+    SM_FileHandle *fh = &mgmtData->fh;
+    RC rc = RC_OK;
+    int totalNumPages = __atomic_load_n(&fh->totalNumPages, __ATOMIC_RELAXED);  // pinPage may grow the file meanwhile
+    if (startPage + maxPages > totalNumPages)
+        maxPages = totalNumPages - startPage;
+
+    int *frameNums = malloc(sizeof(int) * (maxPages > 0 ? maxPages : 1));
+    SM_PageHandle *pages = malloc(sizeof(SM_PageHandle) * (maxPages > 0 ? maxPages : 1));
+    if (frameNums == NULL || pages == NULL)
     {
-        RC rc = forcePage(bm, &(BM_PageHandle){.pageNum = frames[frameNum].pageNum, .data = frames[frameNum].data});
-        if (rc != RC_OK) return rc;
+        free(frameNums);
+        free(pages);
+        return RC_ERROR;
     }
 
-    // Read the new page from disk
-    SM_FileHandle fh;
-    RC rc = openPageFile(bm->pageFile, &fh);
-    if (rc != RC_OK) return rc;
+    // Claim a frame for every page of the run; claimed frames are pinned so they are not chosen twice.
+    // A page that another thread loads meanwhile ends the run like a cached one
+    int count = 0;
+    while (count < maxPages)
+    {
+        PageNumber pageNum = startPage + count;
+        if (lookupFrame(mgmtData, pageNum) != -1)
+            break;
 
-    rc = ensureCapacity(pageNum + 1, &fh);
-    if (rc != RC_OK) {
-        closePageFile(&fh);
-        return rc;
+        int frameNum;
+        bool cachedMeanwhile;
+        rc = claimFrame(bm, pageNum, &frameNum, &cachedMeanwhile);
+        if (rc != RC_OK || frameNum == -1)
+            break;
+        frameNums[count] = frameNum;
+        pages[count] = frames[frameNum].data;
+        count++;
     }
-    // Allocate memory for the page data and read the page from disk.
-    frames[frameNum].data = (SM_PageHandle) malloc(PAGE_SIZE);
-    rc = readBlock(pageNum, &fh, frames[frameNum].data);
-    closePageFile(&fh);
-    if (rc != RC_OK) return rc;
 
-    mgmtData->readIO++;
-    mgmtData->cacheHits++;
-
-    // Update frame information
-    frames[frameNum].pageNum = pageNum;
-    frames[frameNum].isDirty = false;
-    frames[frameNum].fixCount = 1;
-    frames[frameNum].lastUsed = getNumReadIO(bm);
-    if(bm->strategy == RS_LRU)
+    if (count > 0)
     {
-        frames[frameNum].lruCount = mgmtData->cacheHits; // Update for LRU
-    }
+        RC readRC = readBlockRange(startPage, count, fh, pages);
+        for (int i = 0; i < count; i++)
+        {
+            if (readRC != RC_OK)
+            {
+                abandonFrame(mgmtData, frameNums[i]);     // leave the frame empty
+                continue;
+            }
 
-    // Set page handle information
-    page->pageNum = pageNum;
-    page->data = frames[frameNum].data;
+            finishLoad(mgmtData, frameNums[i], false);
+            pthread_rwlock_unlock(&frames[frameNums[i]].latch);
+            unpinFrame(mgmtData, frameNums[i]);
+        }
+        if (rc == RC_OK)
+            rc = readRC;
+    }
 
-    return RC_OK;
+    free(frameNums);
+    free(pages);
+    return rc;
 }
 
 
@@ -378,7 +2316,7 @@ extern PageNumber *getFrameContents(BM_BufferPool *const bm)
 
     // Copy page numbers from frames to contents array
     for (int i = 0; i < bm->numPages; i++) {
-        frameContents[i] =  (frames[i].pageNum != -1) ? frames[i].pageNum : NO_PAGE;
+        frameContents[i] =  PAGE_NUM(&frames[i]);
     }
 
     return frameContents;
@@ -401,7 +2339,7 @@ extern bool *getDirtyFlags(BM_BufferPool *const bm)
 
     // Copy dirty flags from frames to flags array, empty pages are considered clean
     for (int i = 0; i < bm->numPages; i++) {
-        dirtyFlags[i] = frames[i].isDirty;
+        dirtyFlags[i] = IS_DIRTY(&frames[i]);
     }
     return dirtyFlags;
 }
@@ -423,13 +2361,13 @@ extern int *getFixCounts(BM_BufferPool *const bm)
 
     // Copy fix counts from frames to counts array
     for (int i = 0; i < bm->numPages; i++) {
-        if (frames[i].pageNum == NO_PAGE) 
+        if (PAGE_NUM(&frames[i]) == NO_PAGE) 
         {
             fixCounts[i] = 0;  // Empty page frame
         } 
         else 
         {
-            fixCounts[i] = frames[i].fixCount;
+            fixCounts[i] = FIX_COUNT(&frames[i]);
         }
     }
     return fixCounts;
@@ -444,7 +2382,7 @@ extern int getNumReadIO(BM_BufferPool *const bm)
     }
 
     MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
-    return mgmtData->readIO;
+    return __atomic_load_n(&mgmtData->readIO, __ATOMIC_RELAXED);
 }
 
 // Get number of write IOs
@@ -455,5 +2393,30 @@ extern int getNumWriteIO(BM_BufferPool *const bm)
         return -1;
     }
     MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
-    return mgmtData->writeIO;
+    return __atomic_load_n(&mgmtData->writeIO, __ATOMIC_RELAXED);
+}
+
+// Get number of pins that found their page already in the pool
+extern int getNumHits(BM_BufferPool *const bm) 
+{
+    // Check for invalid input
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return -1;
+    }
+    MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
+    return __atomic_load_n(&mgmtData->cacheHits, __ATOMIC_RELAXED);
+}
+
+// Get the fraction of pins that found their page already in the pool (0 before the first pin)
+extern double getHitRatio(BM_BufferPool *const bm) 
+{
+    // Check for invalid input
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return -1;
+    }
+    MgmtInfo *mgmtData = (MgmtInfo *)bm->mgmtData;
+    int pinRequests = __atomic_load_n(&mgmtData->pinRequests, __ATOMIC_RELAXED);
+    if (pinRequests == 0)
+        return 0;
+    return (double)__atomic_load_n(&mgmtData->cacheHits, __ATOMIC_RELAXED) / pinRequests;
 }
\ No newline at end of file
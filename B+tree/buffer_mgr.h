@@ -12,8 +12,9 @@ typedef enum ReplacementStrategy {
 	RS_FIFO = 0,
 	RS_LRU = 1,
 	RS_CLOCK = 2,
-	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LFU = 3,	// stratData: NULL or an int, halve all use counts after that many pins (aging)
+	RS_LRU_K = 4,
+	RS_ARC = 5	// scan resistant: pages used once are evicted before pages used repeatedly
 } ReplacementStrategy;
 
 // Data Types and Structures
@@ -26,13 +27,39 @@ typedef struct BM_BufferPool {
 	ReplacementStrategy strategy;
 	void *mgmtData; // use this one to store the bookkeeping info your buffer
 	// manager needs for a buffer pool
+	int pageSize; // size of the pages of pageFile in bytes, read from the file by initBufferPool
 } BM_BufferPool;
 
+// Settings of RS_LRU_K, passed to initBufferPool as stratData (NULL gives the defaults)
+typedef struct BM_LRUKOptions {
+	int k; // number of most recent references that decide the victim (default 1, the order of RS_LRU)
+	int correlatedPeriod; // a pin within this many pins of the previous one of the page is not a new reference (default 0)
+	int historySize; // number of evicted pages whose references are remembered (default numPages)
+} BM_LRUKOptions;
+
 typedef struct BM_PageHandle {
 	PageNumber pageNum;
 	char *data;
 } BM_PageHandle;
 
+// Latch taken by pinPageLatched on the frame of the page, held until unpinPageLatched with the same mode.
+// Shared latches exclude exclusive ones, so readers see a page only while no writer changes it
+// forcePage writes the page as it is; a caller that shares the page with writers holds a latch across it
+typedef enum BM_LatchMode {
+	BM_LATCH_NONE = 0, // no latch, as pinPage: the caller synchronises access to the page itself
+	BM_LATCH_SHARED = 1,
+	BM_LATCH_EXCLUSIVE = 2
+} BM_LatchMode;
+
+// Optional buffer pool settings for initBufferPoolWithOptions
+typedef struct BM_PoolOptions {
+	int openFlags; // storage manager flags used to open the page file (SM_OPEN_*, e.g. SM_OPEN_DIRECT)
+	int syncPolicy; // when written pages become durable (SM_SYNC_*); forceFlushPool syncs once per flush
+	bool hugePages; // back the frames with huge pages (MAP_HUGETLB if available, else transparent huge pages)
+	int cleanFrames; // percentage of frames a background writer thread keeps clean ahead of eviction, 0 for no writer
+	int dirtyHighWater; // with the writer: percentage of dirty frames above which unpinPage waits for it (0 for the default)
+} BM_PoolOptions;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -44,6 +71,9 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName, 
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const BM_PoolOptions *options);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
 
@@ -53,6 +83,11 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC pinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page, 
+		const PageNumber pageNum, BM_LatchMode mode);
+RC unpinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page, BM_LatchMode mode);
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber startPage,
+		const int numPages);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -60,5 +95,7 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumHits (BM_BufferPool *const bm);
+double getHitRatio (BM_BufferPool *const bm);
 
 #endif
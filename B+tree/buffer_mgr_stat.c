@@ -29,6 +29,15 @@ printPoolContent (BM_BufferPool *const bm)
 	printf("\n");
 }
 
+void
+printPoolStats (BM_BufferPool *const bm)
+{
+	printf("{");
+	printStrat(bm);
+	printf(" %i}: hits %i, hit ratio %.3f, read IO %i, write IO %i\n", bm->numPages,
+		getNumHits(bm), getHitRatio(bm), getNumReadIO(bm), getNumWriteIO(bm));
+}
+
 char *
 sprintPoolContent (BM_BufferPool *const bm)
 {
@@ -98,6 +107,9 @@ printStrat (BM_BufferPool *const bm)
 	case RS_LRU_K:
 		printf("LRU-K");
 		break;
+	case RS_ARC:
+		printf("ARC");
+		break;
 	default:
 		printf("%i", bm->strategy);
 		break;
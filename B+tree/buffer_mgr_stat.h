@@ -6,6 +6,7 @@
 // debug functions
 void printPoolContent (BM_BufferPool *const bm);
 void printPageContent (BM_PageHandle *const page);
+void printPoolStats (BM_BufferPool *const bm);
 char *sprintPoolContent (BM_BufferPool *const bm);
 char *sprintPageContent (BM_PageHandle *const page);
 
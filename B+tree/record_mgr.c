@@ -6,6 +6,7 @@
 #include "storage_mgr.h"
 
 #define ATTRIBUTE_SIZE 15
+#define SCAN_PREFETCH_PAGES 16  // pages read ahead with one vectored read when a scan enters a page that is not cached
 #define RC_SCAN_CONDITION_NOT_FOUND 201
 #define RC_RM_NO_TUPLE_WITH_GIVEN_RID 202
 
@@ -16,6 +17,7 @@ typedef struct RecordManager {
     int tuplesCount;          // Count of tuples in the table
     int freePage;             // First free page for inserting new records
     int scanCount;            // Count of scanned records
+    int scanPage;             // Page a scan keeps pinned while it reads its records, -1 if none
     RID recordID;             // Record ID for current operation
     Expr *condition;          // Condition for scan operations
 } RecordManager;
@@ -23,10 +25,10 @@ typedef struct RecordManager {
 // Global pointer to RecordManager
 RecordManager *recordManager = NULL;
 
-// Helper function to find a free slot in a page
-int findFreeSlot(const char *data, int recordSize)
+// Helper function to find a free slot in a page of pageSize bytes
+int findFreeSlot(const char *data, int recordSize, int pageSize)
 {
-    const int totalSlots = PAGE_SIZE / recordSize;
+    const int totalSlots = pageSize / recordSize;
     
     for (int i = 0; i < totalSlots; i++) {
         // Check if the slot is not occupied ('+' indicates occupied)
@@ -78,13 +80,35 @@ RC shutdownRecordManager() {
 // Create a new table
 extern RC createTable(char *name, Schema *schema)
 {
+    return createTableWithPageSize(name, schema, PAGE_SIZE);
+}
+
+// Create a new table whose page file has pages of pageSize bytes (see createPageFileWithPageSize)
+extern RC createTableWithPageSize(char *name, Schema *schema, int pageSize)
+{
+	// Create the page file first, the buffer pool takes its page size from the file
+	RC status = createPageFileWithPageSize(name, pageSize);
+    if (status != RC_OK) return status;
+
     // Allocate memory for RecordManager and initialize buffer pool
     recordManager = (RecordManager*) malloc(sizeof(RecordManager));
+    if (recordManager == NULL) return RC_WRITE_FAILED;
     // Initialize record manager and buffer pool
-    initBufferPool(&recordManager->bufferPool, name, 100, RS_LRU, NULL);
+    status = initBufferPool(&recordManager->bufferPool, name, 100, RS_LRU, NULL);
+    if (status != RC_OK) {
+        free(recordManager);
+        recordManager = NULL;
+        return status;
+    }
 
     // Prepare page data
-    char data[PAGE_SIZE];
+    char *data = calloc(1, pageSize);
+    if (data == NULL) {
+        shutdownBufferPool(&recordManager->bufferPool);
+        free(recordManager);
+        recordManager = NULL;
+        return RC_WRITE_FAILED;
+    }
     char *schema_str = data;
     SM_FileHandle fh;
 
@@ -107,20 +131,21 @@ extern RC createTable(char *name, Schema *schema)
         *(int*)schema_str = (int)schema->typeLength[i];
         schema_str += sizeof(int);
     }
-	// Create and write to page file
-	RC status = createPageFile(name);
-    if (status != RC_OK) return status;
-
+	// Write the schema page to the page file
     status = openPageFile(name, &fh);
-    if (status != RC_OK) return status;
-
-	status = writeBlock(0, &fh, data);
-    if (status != RC_OK) return status;
-
-	status = closePageFile(&fh);
-    if (status != RC_OK) return status;
+    if (status == RC_OK) {
+        status = writeBlock(0, &fh, data);
+        RC closeStatus = closePageFile(&fh);
+        if (status == RC_OK) status = closeStatus;
+    }
 
-    return RC_OK;
+    free(data);
+    if (status != RC_OK) {
+        shutdownBufferPool(&recordManager->bufferPool);
+        free(recordManager);
+        recordManager = NULL;
+    }
+    return status;
 }
 
 // Open an existing table
@@ -212,7 +237,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
     pageDataPtr = recMgr->pageHandle.data;
 
     // Find a free slot in the current page
-    recID->slot = findFreeSlot(pageDataPtr, recByteSize);
+    recID->slot = findFreeSlot(pageDataPtr, recByteSize, recMgr->bufferPool.pageSize);
 
     // If no free slot is found, move to the next page
     while (recID->slot == -1) {
@@ -220,7 +245,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
         recID->page++; 
         pinPage(&recMgr->bufferPool, &recMgr->pageHandle, recID->page); 
         pageDataPtr = recMgr->pageHandle.data; 
-        recID->slot = findFreeSlot(pageDataPtr, recByteSize); 
+        recID->slot = findFreeSlot(pageDataPtr, recByteSize, recMgr->bufferPool.pageSize); 
     }
 
     // Insert the record
@@ -329,6 +354,7 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
     scanMgmtData->recordID.page = 1;
     scanMgmtData->recordID.slot = 0;
     scanMgmtData->scanCount = 0;
+    scanMgmtData->scanPage = -1;
     scanMgmtData->condition = cond;
     // Set up relation data
     RecordManager *mgmtData;
@@ -352,7 +378,7 @@ RC next(RM_ScanHandle *scan, Record *record) {
     Value *conditionResult = (Value *) malloc(sizeof(Value));
     char *recordData;
     int recordSize = getRecordSize(schema);
-    int totalSlots = PAGE_SIZE / recordSize;
+    int totalSlots = rel->bufferPool.pageSize / recordSize;
     int currentScanCount = scanMgmtData->scanCount;
     int totalTuples = rel->tuplesCount;
 
@@ -372,8 +398,16 @@ RC next(RM_ScanHandle *scan, Record *record) {
                 scanMgmtData->recordID.page++;
             }
         }
-        // Pin the page and get record data
-        pinPage(&rel->bufferPool, &scanMgmtData->pageHandle, scanMgmtData->recordID.page);
+        // Entering a new page: release the previous one, read the page and the following pages in one batch,
+        // and pin it once for all of its records
+        if (scanMgmtData->scanPage != scanMgmtData->recordID.page) {
+            if (scanMgmtData->scanPage != -1)
+                unpinPage(&rel->bufferPool, &scanMgmtData->pageHandle);
+            prefetchPages(&rel->bufferPool, scanMgmtData->recordID.page, SCAN_PREFETCH_PAGES);
+            pinPage(&rel->bufferPool, &scanMgmtData->pageHandle, scanMgmtData->recordID.page);
+            scanMgmtData->scanPage = scanMgmtData->recordID.page;
+        }
+        // Get record data
         recordData = scanMgmtData->pageHandle.data;
         recordData = recordData + (scanMgmtData->recordID.slot * recordSize);
         record->id.page = scanMgmtData->recordID.page;
@@ -388,13 +422,14 @@ RC next(RM_ScanHandle *scan, Record *record) {
         // Evaluate the condition
         evalExpr(record, schema, scanMgmtData->condition, &conditionResult);
         if (conditionResult->v.boolV == TRUE) {
-            unpinPage(&rel->bufferPool, &scanMgmtData->pageHandle);
             return RC_OK;
         }
     }
 
     // No more tuples satisfy the condition
-    unpinPage(&rel->bufferPool, &scanMgmtData->pageHandle);
+    if (scanMgmtData->scanPage != -1)
+        unpinPage(&rel->bufferPool, &scanMgmtData->pageHandle);
+    scanMgmtData->scanPage = -1;
     scanMgmtData->recordID.page = 1;
     scanMgmtData->recordID.slot = 0;
     scanMgmtData->scanCount = 0;
@@ -406,9 +441,10 @@ RC closeScan(RM_ScanHandle *scan) {
     RecordManager *scanMgr = scan->mgmtData;
     RecordManager *tableMgr = scan->rel->mgmtData;
     // If scan was in progress, unpin the page
-    if (scanMgr->scanCount > 0)
+    if (scanMgr->scanPage != -1)
     {
         unpinPage(&tableMgr->bufferPool, &scanMgr->pageHandle);
+        scanMgr->scanPage = -1;
 	// Reset scan parameters
         scanMgr->scanCount = 0;
         scanMgr->recordID.page = 1;
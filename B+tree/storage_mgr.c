@@ -1,395 +1,3871 @@
+#define _GNU_SOURCE     // for mremap
+#define _FILE_OFFSET_BITS 64    // 64 bit off_t on 32 bit systems, page files can exceed 2 GB
+
 #include "storage_mgr.h"
 #include "dberror.h"
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
+#include<stdint.h>
+#include<limits.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/types.h>
+#include<sys/uio.h>
+#include<time.h>
+
+// io_uring is used through the raw system calls, no liburing needed
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include<linux/io_uring.h>
+#include<sys/syscall.h>
+#define SM_HAVE_IO_URING
+#endif
+#endif
+
+// management information kept behind SM_FileHandle.mgmtInfo for an open page file.
+// every file is accessed through a storage backend (see SM_Backend below); most of the fields
+// belong to the file backends, which keep the pages in a file on disk.
+// all block I/O of the default backend is positional (pread/pwrite at headerSize + pageNum * pageSize), so the kernel file offset
+// is never used and several threads can read and write blocks through the same handle.
+// curPagePos in the handle is only a cursor for the relative read/write functions, updated atomically
+// like the access pattern fields, which threads sharing a handle change without a lock.
+// a file opened with openPageFileMapped additionally keeps a shared mapping of all its pages;
+// block reads and writes then become memcpy's from/to the mapping.
+// a file opened with SM_OPEN_DIRECT bypasses the OS page cache, its I/O buffers must be SM_PAGE_ALIGNMENT aligned.
+// a file opened with SM_OPEN_SEGMENTED is stored in segment files of SM_SEGMENT_PAGES pages each:
+// segment 0 is the file itself, segment i is "<fileName>.seg<i>".
+// files made by createPageFile start with a header block (SM_HEADER_SIZE bytes) that records the page size;
+// page 0 follows the header. files written before the header existed have PAGE_SIZE pages and no header.
+// a compressed page file (createCompressedPageFile) stores every page compressed in an extent of its own;
+// a page to extent map in the file says where (see SM_ExtentMap).
+// pages given back with freePage are recorded in a free page bitmap that allocatePage hands out again.
+// files on disk keep the bitmap in "<fileName>.fsm" next to the page file, made by the first freePage.
+struct SM_Backend;
+struct SM_MemFile;
+struct SM_ExtentMap;
+
+typedef struct SM_FileInfo {
+    const struct SM_Backend *backend;   // backend the file was opened with
+    int fd;             // file descriptor of the open page file (segment 0)
+    int *segFds;        // descriptors of all segments (segFds[0] == fd), NULL if the file is not segmented
+    int numSegments;    // number of open segments
+    char *baseName;     // copy of the file name, used to name new segments
+    int pageSize;       // size of a page in bytes
+    int headerSize;     // bytes in front of page 0 (SM_HEADER_SIZE, or 0 for a file without header)
+    int flags;          // SM_OPEN_* flags the file was opened with
+    char *map;          // start of the shared mapping of the file, NULL if the file is not mapped
+    size_t mapSize;     // size of the mapping in bytes (header and totalNumPages pages)
+    int allocatedPages; // pages with disk space reserved by fallocate; can be more than totalNumPages (the logical size)
+    int growPolicy;     // SM_GROW_PREALLOCATE or SM_GROW_SPARSE
+    int extentPages;    // preallocation unit in pages for SM_GROW_PREALLOCATE
+    int noPunchHole;    // the filesystem cannot punch holes, discarded pages are overwritten with zeros
+    int autoAdvice;     // choose the access pattern advice from the reads (see detectAccessPattern)
+    int accessPattern;  // SM_ADVICE_NORMAL, SM_ADVICE_SEQUENTIAL or SM_ADVICE_RANDOM, as last given to the kernel
+    int lastReadPage;   // last page read by readBlock/readBlockRange
+    int sequentialReads;    // reads in a row that continued at the page after the previous one
+    int scatteredReads;     // reads in a row that did not
+    int readaheadEnd;   // pages before this one were announced with SM_ADVICE_WILLNEED during a sequential scan
+    FILE *stream;       // SM_BACKEND_STDIO: buffered stream of the file (fd is its descriptor)
+    struct SM_MemFile *memFile;     // SM_BACKEND_MEMORY: page store holding the file
+    struct SM_ExtentMap *extents;   // compressed file: where its pages are stored, NULL for other files
+    uint64_t *freeMap;  // free page bitmap: bit n % 64 of word n / 64 is set if page n is free
+    int freeMapWords;   // length of freeMap in words
+    uint64_t *freeSummary;  // bit w % 64 of word w / 64 is set if word w of freeMap has a free page
+    int freeHint;       // no summary word before this one has a bit set
+    int numFreePages;   // bits set in freeMap
+    int fsmFd;          // descriptor of the bitmap file on disk, -1 while it is not open (or does not exist yet)
+    char *fsmName;      // name of the bitmap file on disk
+    int syncPolicy;     // SM_SYNC_NONE, SM_SYNC_WRITE or SM_SYNC_GROUP
+    int syncIntervalUs; // SM_SYNC_GROUP: how long a sync waits for more writes to join it
+    int syncBatch;      // SM_SYNC_GROUP: number of waiting writes that starts the sync at once
+    pthread_mutex_t syncLock;
+    pthread_cond_t syncCond;        // signalled when a write joins and when a sync finishes
+    unsigned long long writeSeq;    // number of writes that finished (each write gets the next number)
+    unsigned long long syncedSeq;   // all writes up to this number are durable, or failed (see failedSeq)
+    unsigned long long failedSeq;   // a sync covering the writes up to this number failed, they are not durable
+    int syncing;                    // a group commit leader is waiting for or running a sync
+    SM_IOStats stats;   // I/O statistics (getIOStats), updated with atomic adds since threads share the handle
+    int nextIOPage;     // page after the last one read or written, a transfer starting elsewhere counts as a seek
+} SM_FileInfo;
+
+// a storage backend: where the pages of a file live and how they are moved.
+// the public functions check their arguments and keep the handle up to date, then call the backend
+// of the open file (or, for create/open/destroy, the backend chosen with setStorageBackend).
+// page ranges passed to transfer, grow and shrink are always valid for the file
+typedef struct SM_Backend {
+    RC (*create) (char *fileName, int pageSize);        // create (or replace) a file with one empty page
+    RC (*destroy) (char *fileName);
+    RC (*open) (SM_FileInfo *file_info, char *fileName, int *totalPages);  // file_info->flags is set
+    void (*close) (SM_FileInfo *file_info);
+    RC (*transfer) (SM_FileInfo *file_info, int startPage, int numPages, SM_PageHandle *pages, int isWrite);
+    RC (*grow) (SM_FileInfo *file_info, int oldPages, int numPages);
+    RC (*shrink) (SM_FileInfo *file_info, int numPages);
+    RC (*discard) (SM_FileInfo *file_info, int startPage, int numPages);  // the pages read as zeros afterwards
+    RC (*advise) (SM_FileInfo *file_info, int advice, int startPage, int numPages);   // SM_ADVICE_* except AUTO
+    int (*sync) (SM_FileInfo *file_info);               // 0 on success
+    char *(*pagePointer) (SM_FileInfo *file_info, int pageNum);    // NULL if pages cannot be used in place
+    RC (*loadFreeMap) (SM_FileInfo *file_info, char *fileName);    // read the free page bitmap kept for the file
+    RC (*storeFreeMap) (SM_FileInfo *file_info, int firstWord, int numWords);   // write part of it back
+} SM_Backend;
+
+static const SM_Backend fileBackend;
+static const SM_Backend stdioBackend;
+static const SM_Backend mmapBackend;
+static const SM_Backend memoryBackend;
+static const SM_Backend compressedBackend;
+
+// backend used for files that are created, opened or destroyed from now on (setStorageBackend)
+static const SM_Backend *defaultBackend = &fileBackend;
+
+
+// maximum number of pages moved by one preadv/pwritev call in readBlockRange/writeBlockRange
+#define SM_RANGE_MAX_IOV 256
+
+// default preallocation unit for growing files: 256 pages (1 MB)
+#define SM_DEFAULT_EXTENT_PAGES 256
+
+// group commit defaults: a sync waits up to 1 ms for other writes, or until 32 writes are waiting
+#define SM_DEFAULT_SYNC_INTERVAL_US 1000
+#define SM_DEFAULT_SYNC_BATCH 32
+
+// access pattern detection: this many adjacent reads in a row make a scan sequential,
+// this many scattered reads in a row make the access random
+#define SM_SEQUENTIAL_TRIGGER 4
+#define SM_RANDOM_TRIGGER 8
+
+// a sequential scan keeps the kernel reading this many pages ahead of it (1 MB)
+#define SM_READAHEAD_PAGES 256
+
+// relaxed atomic access to the fields threads sharing a handle update without a lock
+#define LOAD_RELAXED(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define STORE_RELAXED(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+// maximum number of worker threads of the SM_ASYNC_THREADS backend
+#define SM_ASYNC_MAX_WORKERS 8
+
+// on disk header at the start of a page file, the rest of the header block is zero.
+// version 1 files have no format flags; a file that uses any is written as version 2, so older code refuses it
+#define SM_FILE_MAGIC "SMPGFILE"
+#define SM_FORMAT_VERSION 2
+
+// format flags
+#define SM_FORMAT_COMPRESSED 1      // pages are stored compressed, through a page to extent map
+
+typedef struct SM_FileHeader {
+    char magic[8];      // SM_FILE_MAGIC
+    uint32_t version;   // 1, or SM_FORMAT_VERSION if flags are used
+    uint32_t pageSize;  // size of a page in bytes
+    uint32_t flags;     // SM_FORMAT_* flags
+    uint32_t numPages;  // SM_FORMAT_COMPRESSED: number of pages in the file
+    uint64_t mapOffset; // SM_FORMAT_COMPRESSED: file offset of the page to extent map
+} SM_FileHeader;
+
+// compressed files: extents are allocated in multiples of this many bytes
+#define SM_EXTENT_ALIGN 512
+
+// size in bytes of numPages pages
+static off_t pagesSize (SM_FileInfo *file_info, int numPages)
+{
+    return (off_t)numPages * file_info->pageSize;
+}
 
+// byte offset of a page inside the page file (of segment 0 for a segmented file)
+static off_t pageOffset (SM_FileInfo *file_info, int pageNum)
+{
+    return file_info->headerSize + pagesSize(file_info, pageNum);
+}
 
-// storage manager doesn't require any initialization. It takes no paramneters, return nothing
-extern void initStorageManager (void)
+// size in bytes of segment number segment when it holds numPages pages (segment 0 also holds the header)
+static off_t segmentSize (SM_FileInfo *file_info, int segment, int numPages)
 {
-	printf("Assignment group 26\n");
-	printf("Sathvika Sagar Tavitireddy , CWID : A20560449\n");
-	printf("Chaitanya Durgesh Nynavarapu,  CWID : A20561894\n");
+    return (segment == 0 ? file_info->headerSize : 0) + pagesSize(file_info, numPages);
+}
 
-    printf("--------Initializing storage manager ---------\n");
+// name of segment number segment of a segmented page file, written to buf
+static void segmentName (const char *fileName, int segment, char *buf, size_t size)
+{
+    if (segment == 0)
+        snprintf(buf, size, "%s", fileName);
+    else
+        snprintf(buf, size, "%s.seg%d", fileName, segment);
+}
+
+// file descriptor that holds page pageNum, and the byte offset of the page in that file.
+// returns -1 if the page lies in a segment that does not exist
+static int pageLocation (SM_FileInfo *file_info, int pageNum, off_t *offset)
+{
+    if (file_info->segFds == NULL)
+    {
+        *offset = pageOffset(file_info, pageNum);
+        return file_info->fd;
+    }
+
+    int segment = pageNum / SM_SEGMENT_PAGES;
+    *offset = segmentSize(file_info, segment, pageNum % SM_SEGMENT_PAGES);
+    return (segment < file_info->numSegments) ? file_info->segFds[segment] : -1;
 }
 
+// number of pages from pageNum up to the end of its segment (or unlimited for a plain file)
+static int pagesLeftInSegment (SM_FileInfo *file_info, int pageNum)
+{
+    if (file_info->segFds == NULL)
+        return INT_MAX;
+    return SM_SEGMENT_PAGES - (pageNum % SM_SEGMENT_PAGES);
+}
 
-// create a page file with given fileName as input parameters
-extern RC createPageFile (char *fileName)
+// I/O done by the calling thread so far. the low level I/O functions count every system call here;
+// the public functions charge what a call added to the statistics of its file (see beginIO/chargeIO)
+typedef struct SM_ThreadIO {
+    unsigned long long syscalls;
+    unsigned long long syncs;
+    unsigned long long bytesRead;
+    unsigned long long bytesWritten;
+    unsigned long long ns;      // time spent in the system calls
+} SM_ThreadIO;
+
+static __thread SM_ThreadIO threadIO;
+
+// the thread's I/O and the time when a public function started
+typedef struct SM_IOMark {
+    SM_ThreadIO io;
+    unsigned long long startNs;
+} SM_IOMark;
+
+// kinds of calls for chargeIO
+#define SM_CHARGE_READ  0
+#define SM_CHARGE_WRITE 1
+#define SM_CHARGE_OTHER 2
+
+static unsigned long long monotonicNs (void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// count a system call that started at startNs
+static void countSyscall (unsigned long long startNs)
 {
-    // open a file with "filename" for reading and writing in binary mode
-    FILE *page_file = fopen(fileName, "wb+");
+    threadIO.syscalls++;
+    threadIO.ns += monotonicNs() - startNs;
+}
 
-    //check if the file is opened
-    if(page_file == NULL)
+// fdatasync, counted as a sync
+static int dataSync (int fd)
+{
+    unsigned long long start = monotonicNs();
+    int result = fdatasync(fd);
+    countSyscall(start);
+    threadIO.syncs++;
+    return result;
+}
+
+static void beginIO (SM_IOMark *mark)
+{
+    mark->io = threadIO;
+    mark->startNs = monotonicNs();
+}
+
+// histogram bucket of a call that took ns nanoseconds (see SM_LATENCY_BUCKETS)
+static int latencyBucket (unsigned long long ns)
+{
+    unsigned long long us = ns / 1000;
+    int bucket = (us == 0) ? 0 : 64 - __builtin_clzll(us);
+    return (bucket < SM_LATENCY_BUCKETS) ? bucket : SM_LATENCY_BUCKETS - 1;
+}
+
+// add the I/O of the call that began at mark to the statistics of the file.
+// a read or write call also counts as an operation on numPages pages from startPage
+static void chargeIO (SM_FileInfo *file_info, SM_IOMark *mark, int kind, int startPage, int numPages)
+{
+    SM_IOStats *stats = &file_info->stats;
+    unsigned long long elapsed = monotonicNs() - mark->startNs;
+
+    __atomic_fetch_add(&stats->syscalls, threadIO.syscalls - mark->io.syscalls, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->syncs, threadIO.syncs - mark->io.syncs, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->bytesRead, threadIO.bytesRead - mark->io.bytesRead, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->bytesWritten, threadIO.bytesWritten - mark->io.bytesWritten, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->ioWaitNs, threadIO.ns - mark->io.ns, __ATOMIC_RELAXED);
+    if (kind == SM_CHARGE_OTHER)
+        return;
+
+    if (__atomic_exchange_n(&file_info->nextIOPage, startPage + numPages, __ATOMIC_RELAXED) != startPage)
+        __atomic_fetch_add(&stats->seeks, 1, __ATOMIC_RELAXED);
+    if (kind == SM_CHARGE_READ)
     {
-        return RC_FILE_NOT_FOUND;   //if file opening is failed
+        __atomic_fetch_add(&stats->reads, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->pagesRead, numPages, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->readNs, elapsed, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->readLatency[latencyBucket(elapsed)], 1, __ATOMIC_RELAXED);
     }
-    
-    // create an empty page by allocating memory for one page (initializes memory with zero('\0') bytes)
-    SM_PageHandle empty_page = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
+    else
+    {
+        __atomic_fetch_add(&stats->writes, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->pagesWritten, numPages, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->writeNs, elapsed, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->writeLatency[latencyBucket(elapsed)], 1, __ATOMIC_RELAXED);
+    }
+}
 
-    if(empty_page == NULL)
+// read exactly size bytes at offset. pread may return less than requested or be interrupted by a signal,
+// so keep reading until the whole range is filled. returns the number of bytes read (less than size only at end of file)
+static ssize_t preadFully (int fd, char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size)
     {
-        // if failed to allocate memory
-        fclose(page_file);      // close the file to prevent resource leaks
-        return RC_WRITE_FAILED; 
+        unsigned long long start = monotonicNs();
+        ssize_t n = pread(fd, buf + done, size - done, offset + done);
+        countSyscall(start);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;       // interrupted before anything was read, retry
+            return -1;
+        }
+        if (n == 0)
+            break;              // end of file
+        done += n;
+        threadIO.bytesRead += n;
+    }
+    return done;
+}
+
+// write exactly size bytes at offset, retrying short and interrupted writes. returns 0 on success, -1 on failure
+static int pwriteFully (int fd, const char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        unsigned long long start = monotonicNs();
+        ssize_t n = pwrite(fd, buf + done, size - done, offset + done);
+        countSyscall(start);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        done += n;
+        threadIO.bytesWritten += n;
+    }
+    return 0;
+}
+
+// vectored version of preadFully/pwriteFully: transfer all iovcnt buffers starting at offset,
+// continuing after short transfers. returns the number of bytes transferred, -1 on error
+static ssize_t transferVectorFully (int fd, struct iovec *iov, int iovcnt, off_t offset, int isWrite)
+{
+    size_t done = 0;
+    while (iovcnt > 0)
+    {
+        unsigned long long start = monotonicNs();
+        ssize_t n = isWrite ? pwritev(fd, iov, iovcnt, offset + done) : preadv(fd, iov, iovcnt, offset + done);
+        countSyscall(start);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            break;              // end of file
+        done += n;
+        if (isWrite)
+            threadIO.bytesWritten += n;
+        else
+            threadIO.bytesRead += n;
+
+        // skip the buffers that were completely transferred and trim a partially transferred one
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0 && n > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return done;
+}
+
+// true if the buffer can be handed to an O_DIRECT read or write as is
+static int isPageAligned (const char *buf)
+{
+    return ((uintptr_t)buf % SM_PAGE_ALIGNMENT) == 0;
+}
+
+// read page pageNum. O_DIRECT needs an aligned buffer, so an unaligned
+// caller buffer is read through an aligned bounce page
+static ssize_t readPageAt (SM_FileInfo *file_info, char *memPage, int pageNum)
+{
+    off_t offset;
+    int fd = pageLocation(file_info, pageNum, &offset);
+    if (fd < 0)
+        return -1;
+
+    if (!(file_info->flags & SM_OPEN_DIRECT) || isPageAligned(memPage))
+        return preadFully(fd, memPage, file_info->pageSize, offset);
+
+    SM_PageHandle bounce = allocAlignedBuffer(file_info->pageSize);
+    if (bounce == NULL)
+        return -1;
+    ssize_t n = preadFully(fd, bounce, file_info->pageSize, offset);
+    if (n > 0)
+        memcpy(memPage, bounce, n);
+    freeAlignedPage(bounce);
+    return n;
+}
+
+// write page pageNum, through an aligned bounce page if needed (see readPageAt)
+static int writePageAt (SM_FileInfo *file_info, const char *memPage, int pageNum)
+{
+    off_t offset;
+    int fd = pageLocation(file_info, pageNum, &offset);
+    if (fd < 0)
+        return -1;
+
+    if (!(file_info->flags & SM_OPEN_DIRECT) || isPageAligned(memPage))
+        return pwriteFully(fd, memPage, file_info->pageSize, offset);
+
+    SM_PageHandle bounce = allocAlignedBuffer(file_info->pageSize);
+    if (bounce == NULL)
+        return -1;
+    memcpy(bounce, memPage, file_info->pageSize);
+    int rc = pwriteFully(fd, bounce, file_info->pageSize, offset);
+    freeAlignedPage(bounce);
+    return rc;
+}
+
+// read or write numPages adjacent pages starting at startPage from/to the buffers in pages[].
+// each run of up to SM_RANGE_MAX_IOV pages is a single preadv/pwritev call
+static RC transferBlockRange (SM_FileInfo *file_info, int startPage, int numPages, SM_PageHandle *pages, int isWrite)
+{
+    RC failRC = isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+    // direct I/O needs every buffer aligned, otherwise go page by page through the bounce buffer
+    if (file_info->flags & SM_OPEN_DIRECT)
+    {
+        for (int i = 0; i < numPages; i++)
+        {
+            if (isPageAligned(pages[i]))
+                continue;
+
+            for (int j = 0; j < numPages; j++)
+            {
+                if (isWrite ? writePageAt(file_info, pages[j], startPage + j) != 0
+                            : readPageAt(file_info, pages[j], startPage + j) != file_info->pageSize)
+                    return failRC;
+            }
+            return RC_OK;
+        }
+    }
+
+    struct iovec iov[SM_RANGE_MAX_IOV];
+    int count;
+    for (int first = 0; first < numPages; first += count)
+    {
+        count = numPages - first;
+        if (count > SM_RANGE_MAX_IOV)
+            count = SM_RANGE_MAX_IOV;
+        // a vectored call reaches into one segment only
+        if (count > pagesLeftInSegment(file_info, startPage + first))
+            count = pagesLeftInSegment(file_info, startPage + first);
+
+        off_t offset;
+        int fd = pageLocation(file_info, startPage + first, &offset);
+        if (fd < 0)
+            return failRC;
+
+        for (int i = 0; i < count; i++)
+        {
+            iov[i].iov_base = pages[first + i];
+            iov[i].iov_len = file_info->pageSize;
+        }
+
+        ssize_t expected = pagesSize(file_info, count);
+        if (transferVectorFully(fd, iov, count, offset, isWrite) != expected)
+            return failRC;
+    }
+    return RC_OK;
+}
+
+// (re)map the first numPages pages of the file. the first call creates the mapping,
+// later calls grow it with mremap, which may move it (pointers from getBlockPointer become invalid)
+static RC remapPageFile (SM_FileInfo *file_info, int numPages)
+{
+    size_t newSize = (size_t)pageOffset(file_info, numPages);
+
+    if (newSize == file_info->mapSize)
+        return RC_OK;
+
+    char *newMap;
+    if (file_info->map == NULL)
+        newMap = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, file_info->fd, 0);
+    else
+        newMap = mremap(file_info->map, file_info->mapSize, newSize, MREMAP_MAYMOVE);
+
+    if (newMap == MAP_FAILED)
+        return RC_WRITE_FAILED;
+
+    file_info->map = newMap;
+    file_info->mapSize = newSize;
+    return RC_OK;
+}
+
+
+// open (and with create set, create) segments until the file has numSegments of them
+static RC openSegments (SM_FileInfo *file_info, int numSegments, int create)
+{
+    if (numSegments <= file_info->numSegments)
+        return RC_OK;
+
+    int *segFds = (int *)realloc(file_info->segFds, sizeof(int) * numSegments);
+    if (segFds == NULL)
+        return RC_WRITE_FAILED;
+    file_info->segFds = segFds;
+
+    char name[PATH_MAX];
+    int open_flags = O_RDWR | (create ? O_CREAT : 0) | ((file_info->flags & SM_OPEN_DIRECT) ? O_DIRECT : 0);
+    while (file_info->numSegments < numSegments)
+    {
+        segmentName(file_info->baseName, file_info->numSegments, name, sizeof(name));
+        int fd = open(name, open_flags, 0644);
+        if (fd < 0)
+            return create ? RC_WRITE_FAILED : RC_FILE_NOT_FOUND;
+        file_info->segFds[file_info->numSegments++] = fd;
+    }
+    return RC_OK;
+}
+
+// grow a file of oldPages pages to numberOfPages pages. the logical size (totalNumPages, the end of file) moves with one ftruncate;
+// with SM_GROW_PREALLOCATE disk space is reserved in whole extents beyond the end of file (FALLOC_FL_KEEP_SIZE),
+// so a bulk load pays for one fallocate per extent instead of one write per page
+static RC growDiskFile (SM_FileInfo *file_info, int oldPages, int numberOfPages)
+{
+    // a segmented file first gets all the segments the new size reaches into
+    if (file_info->segFds != NULL)
+    {
+        RC rc = openSegments(file_info, (numberOfPages - 1) / SM_SEGMENT_PAGES + 1, 1);
+        if (rc != RC_OK)
+            return rc;
+    }
+
+    if (file_info->growPolicy == SM_GROW_PREALLOCATE && numberOfPages > file_info->allocatedPages)
+    {
+        long long extent = file_info->extentPages;
+        long long target = ((numberOfPages + extent - 1) / extent) * extent;
+        int from = (file_info->allocatedPages > oldPages) ? file_info->allocatedPages : oldPages;
+
+        // preallocation never reaches into a segment that holds no pages yet
+        if (file_info->segFds != NULL && target > (long long)file_info->numSegments * SM_SEGMENT_PAGES)
+            target = (long long)file_info->numSegments * SM_SEGMENT_PAGES;
+        if (target > INT_MAX)
+            target = INT_MAX;
+
+        // reserve the range segment by segment (a plain file is a single segment)
+        int ok = 1;
+        int count;
+        for (int page = from; page < target && ok; page += count)
+        {
+            count = (int)(target - page);
+            if (count > pagesLeftInSegment(file_info, page))
+                count = pagesLeftInSegment(file_info, page);
+
+            off_t offset;
+            int fd = pageLocation(file_info, page, &offset);
+            if (fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, pagesSize(file_info, count)) != 0)
+            {
+                ok = 0;
+                if (errno == EOPNOTSUPP)
+                    file_info->growPolicy = SM_GROW_SPARSE;   // filesystem cannot preallocate, grow sparse from now on
+            }
+        }
+        if (ok)
+            file_info->allocatedPages = (int)target;
     }
 
-    // write the empty page to the page file pointer
-    if (fwrite(empty_page, sizeof(char), PAGE_SIZE, page_file) < PAGE_SIZE) 
+    // the pages between the old and the new end of file read as zero bytes.
+    // in a segmented file every segment before the last one is full
+    if (file_info->segFds != NULL)
     {
-        //if the number of bytes written to page file is less than PAGE_SIZE, write operation is not successful
-        free(empty_page);     // free the allocated memory
-        fclose(page_file);    // close the file to prevent resource leaks
+        int lastSegment = (numberOfPages - 1) / SM_SEGMENT_PAGES;
+        for (int segment = oldPages / SM_SEGMENT_PAGES; segment <= lastSegment; segment++)
+        {
+            int pages = (segment < lastSegment) ? SM_SEGMENT_PAGES : numberOfPages - segment * SM_SEGMENT_PAGES;
+            if (ftruncate(file_info->segFds[segment], segmentSize(file_info, segment, pages)) != 0)
+                return RC_WRITE_FAILED;
+        }
+    }
+    else if (ftruncate(file_info->fd, pageOffset(file_info, numberOfPages)) != 0)
         return RC_WRITE_FAILED;
+
+    return RC_OK;
+}
+
+// grow the open file to numberOfPages pages (new pages are zero) and update the handle
+static RC growPageFile (SM_FileHandle *fHandle, int numberOfPages)
+{
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+
+    SM_IOMark mark;
+    beginIO(&mark);
+    RC rc = file_info->backend->grow(file_info, fHandle->totalNumPages, numberOfPages);
+    chargeIO(file_info, &mark, SM_CHARGE_OTHER, 0, 0);
+    if (rc != RC_OK)
+        return rc;
+
+    __atomic_fetch_add(&file_info->stats.extensions, 1, __ATOMIC_RELAXED);
+    STORE_RELAXED(fHandle->totalNumPages, numberOfPages);
+    return RC_OK;
+}
+
+// flush the written data of the file (all segments) to stable storage
+static int syncDiskFile (SM_FileInfo *file_info)
+{
+    if (file_info->fsmFd >= 0 && dataSync(file_info->fsmFd) != 0)
+        return -1;
+    if (file_info->segFds == NULL)
+        return dataSync(file_info->fd);
+
+    for (int i = 0; i < file_info->numSegments; i++)
+    {
+        if (dataSync(file_info->segFds[i]) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// make the write that just finished durable under SM_SYNC_GROUP.
+// the first writer that finds no sync running becomes the leader: it waits up to syncIntervalUs
+// (or until syncBatch writes wait) for more writes to join, then one fdatasync covers all of them.
+// the other writers wait until a sync that covers their write has finished.
+// a failed fdatasync may have marked the pages clean all the same, so a later sync would succeed without
+// writing them: every write the failed sync covered reports RC_WRITE_FAILED, none of them is retried
+static RC groupCommit (SM_FileInfo *file_info)
+{
+    RC rc = RC_OK;
+    pthread_mutex_lock(&file_info->syncLock);
+    unsigned long long seq = ++file_info->writeSeq;
+    pthread_cond_broadcast(&file_info->syncCond);
+
+    while (file_info->syncedSeq < seq)
+    {
+        if (file_info->syncing)
+        {
+            pthread_cond_wait(&file_info->syncCond, &file_info->syncLock);
+            continue;
+        }
+
+        // become the leader and give other writers a chance to join the sync
+        file_info->syncing = 1;
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += (long)file_info->syncIntervalUs * 1000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        while (file_info->writeSeq - file_info->syncedSeq < (unsigned long long)file_info->syncBatch)
+        {
+            if (pthread_cond_timedwait(&file_info->syncCond, &file_info->syncLock, &deadline) == ETIMEDOUT)
+                break;
+        }
+
+        unsigned long long target = file_info->writeSeq;
+        pthread_mutex_unlock(&file_info->syncLock);
+        int failed = file_info->backend->sync(file_info);
+        pthread_mutex_lock(&file_info->syncLock);
+
+        file_info->syncing = 0;
+        if (failed)
+            file_info->failedSeq = target;
+        file_info->syncedSeq = target;
+        pthread_cond_broadcast(&file_info->syncCond);
+    }
+
+    if (seq <= file_info->failedSeq)
+        rc = RC_WRITE_FAILED;
+    pthread_mutex_unlock(&file_info->syncLock);
+    return rc;
+}
+
+// called after a successful write: make it durable as syncPolicy (normally the policy of the file) asks
+static RC syncAfterWrite (SM_FileInfo *file_info, int syncPolicy)
+{
+    switch (syncPolicy)
+    {
+        case SM_SYNC_WRITE:
+            return (file_info->backend->sync(file_info) == 0) ? RC_OK : RC_WRITE_FAILED;
+        case SM_SYNC_GROUP:
+            return groupCommit(file_info);
+        default:
+            return RC_OK;
+    }
+}
+
+
+/************************************************************
+ *                  compressed page files                   *
+ ************************************************************/
+
+// page codec: a byte oriented LZ77 coder in the style of LZ4. the output is a sequence of
+//   token (literal count << 4 | match length - SM_LZ_MIN_MATCH), [more literal count], literals,
+//   match offset (2 bytes, little endian), [more match length]
+// a count of 15 in the token continues in the following bytes (each 255 adds 255, the first byte below 255 ends it).
+// the last sequence has only literals. records padded with zeros and the runs of '+'/'-' slot markers of the
+// record manager shrink to a few bytes
+#define SM_LZ_MIN_MATCH 4
+#define SM_LZ_MAX_OFFSET 65535
+#define SM_LZ_HASH_BITS 12
+
+static uint32_t lzHash (const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (v * 2654435761u) >> (32 - SM_LZ_HASH_BITS);
+}
+
+static unsigned char *lzPutLength (unsigned char *op, int length)
+{
+    for (; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+// write a sequence of litLen literals and a match of matchLen bytes at offset (matchLen 0: the last sequence).
+// returns the new end of the output, or NULL if it does not fit before oend
+static unsigned char *lzSequence (unsigned char *op, unsigned char *oend, const unsigned char *literals, int litLen,
+                                  int offset, int matchLen)
+{
+    if (oend - op < 1 + litLen + litLen / 255 + 1 + 2 + matchLen / 255 + 1)
+        return NULL;
+
+    unsigned char *token = op++;
+    int code = (litLen < 15 ? litLen : 15) << 4;
+    if (litLen >= 15)
+        op = lzPutLength(op, litLen - 15);
+    memcpy(op, literals, litLen);
+    op += litLen;
+
+    if (matchLen > 0)
+    {
+        *op++ = offset & 0xff;
+        *op++ = offset >> 8;
+        int extra = matchLen - SM_LZ_MIN_MATCH;
+        code |= (extra < 15) ? extra : 15;
+        if (extra >= 15)
+            op = lzPutLength(op, extra - 15);
+    }
+    *token = (unsigned char)code;
+    return op;
+}
+
+// compress srcLen (at most 65536) bytes. returns the compressed size, or 0 if it would exceed dstCapacity
+static int lzCompress (const char *src, int srcLen, char *dst, int dstCapacity)
+{
+    const unsigned char *in = (const unsigned char *)src;
+    const unsigned char *ip = in, *anchor = in, *iend = in + srcLen;
+    unsigned char *op = (unsigned char *)dst, *oend = op + dstCapacity;
+    uint16_t table[1 << SM_LZ_HASH_BITS];     // last position of each hashed 4 byte string
+
+    memset(table, 0, sizeof(table));
+    while (iend - ip >= SM_LZ_MIN_MATCH)
+    {
+        uint32_t h = lzHash(ip);
+        const unsigned char *ref = in + table[h];
+        table[h] = (uint16_t)(ip - in);
+
+        if (ref >= ip || ip - ref > SM_LZ_MAX_OFFSET || memcmp(ref, ip, SM_LZ_MIN_MATCH) != 0)
+        {
+            // step faster through data that does not compress
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+
+        const unsigned char *end = ip + SM_LZ_MIN_MATCH;
+        while (end < iend && *end == ref[end - ip])
+            end++;
+
+        op = lzSequence(op, oend, anchor, ip - anchor, ip - ref, end - ip);
+        if (op == NULL)
+            return 0;
+        ip = anchor = end;
+    }
+
+    if (anchor < iend)
+    {
+        op = lzSequence(op, oend, anchor, iend - anchor, 0, 0);
+        if (op == NULL)
+            return 0;
+    }
+    return op - (unsigned char *)dst;
+}
+
+// add the continuation bytes of a count to *length. returns 0, or -1 if the input ends first
+static int lzGetLength (const unsigned char **ip, const unsigned char *iend, int *length)
+{
+    int b;
+    do
+    {
+        if (*ip >= iend)
+            return -1;
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+    return 0;
+}
+
+// decompress srcLen bytes into at most dstCapacity bytes. returns the decompressed size, or -1 for corrupt input
+static int lzDecompress (const char *src, int srcLen, char *dst, int dstCapacity)
+{
+    const unsigned char *ip = (const unsigned char *)src, *iend = ip + srcLen;
+    unsigned char *out = (unsigned char *)dst, *op = out, *oend = out + dstCapacity;
+
+    while (ip < iend)
+    {
+        int token = *ip++;
+        int litLen = token >> 4;
+        if (litLen == 15 && lzGetLength(&ip, iend, &litLen) != 0)
+            return -1;
+        if (litLen > iend - ip || litLen > oend - op)
+            return -1;
+        memcpy(op, ip, litLen);
+        op += litLen;
+        ip += litLen;
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        int matchLen = token & 15;
+        if (matchLen == 15 && lzGetLength(&ip, iend, &matchLen) != 0)
+            return -1;
+        matchLen += SM_LZ_MIN_MATCH;
+        if (offset == 0 || offset > op - out || matchLen > oend - op)
+            return -1;
+
+        // byte by byte: a match may overlap the bytes it produces (a run)
+        const unsigned char *ref = op - offset;
+        while (matchLen-- > 0)
+            *op++ = *ref++;
+    }
+    return op - out;
+}
+
+// where a page of a compressed file is stored: length bytes at offset, in an extent of capacity bytes.
+// length 0 is a page of zeros that has no extent, length == pageSize a page that did not compress
+typedef struct SM_PageExtent {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t capacity;
+} SM_PageExtent;
+
+// a run of bytes in a compressed file
+typedef struct SM_FileRun {
+    off_t offset;
+    off_t size;
+} SM_FileRun;
+
+// page to extent map of an open compressed file. the map is written to the file as an array of SM_PageExtent
+// when the file is synced or closed: always to a new extent, and then the header is pointed at it.
+// extents given up since then go to pending, not free: until the header moves on, the map on disk
+// may still use them, so a crash leaves the file as it was at the last sync (apart from pages
+// rewritten in place, which can tear like pages of an uncompressed file)
+typedef struct SM_ExtentMap {
+    SM_PageExtent *pages;   // one entry per page
+    int numPages;
+    int capacity;           // length of pages[]
+    off_t mapOffset;        // extent of the map that the header points at
+    off_t mapCapacity;
+    off_t end;              // end of the used part of the file, extents that do not fit a free run go here
+    SM_FileRun *free;       // unused runs, sorted by offset and coalesced
+    int numFree;
+    int freeCapacity;
+    SM_FileRun *pending;    // extents given up since the map was last written
+    int numPending;
+    int pendingCapacity;
+    int dirty;              // the map changed since it was last written
+    pthread_mutex_t lock;   // protects all of the above
+} SM_ExtentMap;
+
+// bytes allocated for an extent holding length bytes
+static off_t extentSize (off_t length)
+{
+    return (length + SM_EXTENT_ALIGN - 1) / SM_EXTENT_ALIGN * SM_EXTENT_ALIGN;
+}
+
+static void freeExtentMap (SM_ExtentMap *map)
+{
+    if (map == NULL)
+        return;
+    free(map->pages);
+    free(map->free);
+    free(map->pending);
+    pthread_mutex_destroy(&map->lock);
+    free(map);
+}
+
+// make room for one more run. if that fails the run is not recorded and its space stays unused until the
+// file is opened again (the free space is rebuilt from the map then)
+static int reserveRun (SM_FileRun **runs, int count, int *capacity)
+{
+    if (count < *capacity)
+        return 1;
+    int newCapacity = (*capacity > 0) ? *capacity * 2 : 16;
+    SM_FileRun *grown = (SM_FileRun *)realloc(*runs, sizeof(SM_FileRun) * newCapacity);
+    if (grown == NULL)
+        return 0;
+    *runs = grown;
+    *capacity = newCapacity;
+    return 1;
+}
+
+// return a run to the free space, merging it with its neighbours
+static void releaseRun (SM_ExtentMap *map, off_t offset, off_t size)
+{
+    int i = map->numFree;
+    while (i > 0 && map->free[i - 1].offset > offset)
+        i--;
+
+    int joinsPrev = (i > 0 && map->free[i - 1].offset + map->free[i - 1].size == offset);
+    int joinsNext = (i < map->numFree && offset + size == map->free[i].offset);
+    if (joinsPrev && joinsNext)
+    {
+        map->free[i - 1].size += size + map->free[i].size;
+        memmove(&map->free[i], &map->free[i + 1], sizeof(SM_FileRun) * (map->numFree - i - 1));
+        map->numFree--;
+    }
+    else if (joinsPrev)
+        map->free[i - 1].size += size;
+    else if (joinsNext)
+    {
+        map->free[i].offset = offset;
+        map->free[i].size += size;
+    }
+    else if (reserveRun(&map->free, map->numFree, &map->freeCapacity))
+    {
+        memmove(&map->free[i + 1], &map->free[i], sizeof(SM_FileRun) * (map->numFree - i));
+        map->free[i] = (SM_FileRun){ .offset = offset, .size = size };
+        map->numFree++;
+    }
+}
+
+// give up an extent the map on disk may still use, it becomes free when the map is written next
+static void retireExtent (SM_ExtentMap *map, off_t offset, off_t size)
+{
+    if (size > 0 && reserveRun(&map->pending, map->numPending, &map->pendingCapacity))
+        map->pending[map->numPending++] = (SM_FileRun){ .offset = offset, .size = size };
+}
+
+// find size bytes for a new extent: the first free run that is large enough, or the end of the file
+static off_t allocExtent (SM_ExtentMap *map, off_t size)
+{
+    for (int i = 0; i < map->numFree; i++)
+    {
+        SM_FileRun *run = &map->free[i];
+        if (run->size < size)
+            continue;
+
+        off_t offset = run->offset;
+        run->offset += size;
+        run->size -= size;
+        if (run->size == 0)
+        {
+            memmove(run, run + 1, sizeof(SM_FileRun) * (map->numFree - i - 1));
+            map->numFree--;
+        }
+        return offset;
+    }
+
+    off_t offset = map->end;
+    map->end += size;
+    return offset;
+}
+
+// punch a hole for the whole filesystem blocks of the free run that contains offset
+static void punchFreeRun (SM_FileInfo *file_info, off_t offset)
+{
+    SM_ExtentMap *map = file_info->extents;
+    int low = 0, high = map->numFree - 1;
+    while (low <= high)
+    {
+        int mid = (low + high) / 2;
+        SM_FileRun *run = &map->free[mid];
+        if (run->offset + run->size <= offset)
+            low = mid + 1;
+        else if (run->offset > offset)
+            high = mid - 1;
+        else
+        {
+            off_t start = (run->offset + SM_PAGE_ALIGNMENT - 1) / SM_PAGE_ALIGNMENT * SM_PAGE_ALIGNMENT;
+            off_t end = (run->offset + run->size) / SM_PAGE_ALIGNMENT * SM_PAGE_ALIGNMENT;
+            if (end > start && fallocate(file_info->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, start, end - start) != 0)
+                file_info->noPunchHole = 1;
+            return;
+        }
+    }
+}
+
+static int compareRuns (const void *a, const void *b)
+{
+    off_t x = ((const SM_FileRun *)a)->offset, y = ((const SM_FileRun *)b)->offset;
+    return (x > y) - (x < y);
+}
+
+// read the page to extent map of the compressed file open as file_info->fd; the free space is what lies
+// between the extents in use
+static RC loadExtentMap (SM_FileInfo *file_info, SM_FileHeader *header)
+{
+    SM_ExtentMap *map = (SM_ExtentMap *)calloc(1, sizeof(SM_ExtentMap));
+    if (map == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    pthread_mutex_init(&map->lock, NULL);
+    file_info->extents = map;       // released by closeDiskFile, also on failure
+
+    size_t mapBytes = (size_t)header->numPages * sizeof(SM_PageExtent);
+    map->numPages = header->numPages;
+    map->capacity = (header->numPages > 0) ? header->numPages : 1;
+    map->mapOffset = header->mapOffset;
+    map->mapCapacity = extentSize(mapBytes);
+    map->pages = (SM_PageExtent *)malloc(sizeof(SM_PageExtent) * map->capacity);
+    SM_FileRun *used = (SM_FileRun *)malloc(sizeof(SM_FileRun) * (map->numPages + 1));
+    if (map->pages == NULL || used == NULL)
+    {
+        free(used);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (mapBytes > 0 && preadFully(file_info->fd, (char *)map->pages, mapBytes, map->mapOffset) != (ssize_t)mapBytes)
+    {
+        free(used);
+        return RC_INVALID_PAGE_FILE;
+    }
+
+    int numUsed = 0;
+    if (map->mapCapacity > 0)
+        used[numUsed++] = (SM_FileRun){ .offset = map->mapOffset, .size = map->mapCapacity };
+    for (int i = 0; i < map->numPages; i++)
+    {
+        SM_PageExtent *extent = &map->pages[i];
+        if (extent->length > (uint32_t)file_info->pageSize || extent->length > extent->capacity)
+        {
+            free(used);
+            return RC_INVALID_PAGE_FILE;
+        }
+        if (extent->capacity > 0)
+            used[numUsed++] = (SM_FileRun){ .offset = extent->offset, .size = extent->capacity };
+    }
+
+    // extents must lie behind the header and must not overlap
+    qsort(used, numUsed, sizeof(SM_FileRun), compareRuns);
+    off_t pos = SM_HEADER_SIZE;
+    for (int i = 0; i < numUsed; i++)
+    {
+        if (used[i].offset < pos)
+        {
+            free(used);
+            return RC_INVALID_PAGE_FILE;
+        }
+        if (used[i].offset > pos)
+            releaseRun(map, pos, used[i].offset - pos);
+        pos = used[i].offset + used[i].size;
+    }
+    map->end = pos;
+    free(used);
+    return RC_OK;
+}
+
+// write the map of a compressed file to a new extent and point the header at it, if the map changed.
+// durable: the pages and the map reach stable storage before the header does, and the header after it
+static RC writeExtentMap (SM_FileInfo *file_info, int durable)
+{
+    SM_ExtentMap *map = file_info->extents;
+    RC rc = RC_OK;
+
+    pthread_mutex_lock(&map->lock);
+    if (!map->dirty)
+    {
+        pthread_mutex_unlock(&map->lock);
+        return (durable && dataSync(file_info->fd) != 0) ? RC_WRITE_FAILED : RC_OK;
+    }
+
+    size_t mapBytes = (size_t)map->numPages * sizeof(SM_PageExtent);
+    off_t mapCapacity = extentSize(mapBytes);
+    off_t mapOffset = (mapCapacity > 0) ? allocExtent(map, mapCapacity) : SM_HEADER_SIZE;
+    if (mapBytes > 0 && pwriteFully(file_info->fd, (char *)map->pages, mapBytes, mapOffset) != 0)
+        rc = RC_WRITE_FAILED;
+    if (rc == RC_OK && durable && dataSync(file_info->fd) != 0)
+        rc = RC_WRITE_FAILED;
+
+    SM_FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SM_FILE_MAGIC, sizeof(header.magic));
+    header.version = SM_FORMAT_VERSION;
+    header.pageSize = file_info->pageSize;
+    header.flags = SM_FORMAT_COMPRESSED;
+    header.numPages = map->numPages;
+    header.mapOffset = mapOffset;
+    if (rc == RC_OK && pwriteFully(file_info->fd, (char *)&header, sizeof(header), 0) != 0)
+        rc = RC_WRITE_FAILED;
+    if (rc == RC_OK && durable && dataSync(file_info->fd) != 0)
+        rc = RC_WRITE_FAILED;
+
+    if (rc != RC_OK)
+    {
+        // the header still points at the old map, the new extent is not needed
+        if (mapCapacity > 0)
+            releaseRun(map, mapOffset, mapCapacity);
+        pthread_mutex_unlock(&map->lock);
+        return rc;
+    }
+
+    // the old map and the extents given up before it are no longer used by the file on disk,
+    // their blocks go back to the filesystem until they are allocated again
+    if (map->mapCapacity > 0)
+        retireExtent(map, map->mapOffset, map->mapCapacity);
+    for (int i = 0; i < map->numPending; i++)
+        releaseRun(map, map->pending[i].offset, map->pending[i].size);
+    for (int i = 0; i < map->numPending && !file_info->noPunchHole; i++)
+        punchFreeRun(file_info, map->pending[i].offset);
+    map->numPending = 0;
+    map->mapOffset = mapOffset;
+    map->mapCapacity = mapCapacity;
+    map->dirty = 0;
+
+    // free space at the end of the file is given back to the filesystem
+    SM_FileRun *last = (map->numFree > 0) ? &map->free[map->numFree - 1] : NULL;
+    if (last != NULL && last->offset + last->size == map->end && ftruncate(file_info->fd, last->offset) == 0)
+    {
+        map->end = last->offset;
+        map->numFree--;
+    }
+    pthread_mutex_unlock(&map->lock);
+    return RC_OK;
+}
+
+// 1 if all size bytes of page are zero
+static int isZeroPage (const char *page, int size)
+{
+    return page[0] == 0 && memcmp(page, page + 1, size - 1) == 0;
+}
+
+
+
+/************************************************************
+ *                     free page map                        *
+ ************************************************************/
+
+// number of summary words covering a free page bitmap of words words
+#define FREE_SUMMARY_WORDS(words) (((words) + 63) / 64)
+
+// bring the summary bit of word w of the free page bitmap in line with the word
+static void updateFreeSummary (SM_FileInfo *file_info, int w)
+{
+    uint64_t bit = (uint64_t)1 << (w % 64);
+    if (file_info->freeMap[w] != 0)
+        file_info->freeSummary[w / 64] |= bit;
+    else
+        file_info->freeSummary[w / 64] &= ~bit;
+}
+
+// make room in the free page bitmap (and its summary) for page pageNum
+static RC reserveFreeMap (SM_FileInfo *file_info, int pageNum)
+{
+    int words = pageNum / 64 + 1;
+    if (words <= file_info->freeMapWords)
+        return RC_OK;
+
+    if (words < file_info->freeMapWords * 2)
+        words = file_info->freeMapWords * 2;
+    uint64_t *map = (uint64_t *)realloc(file_info->freeMap, sizeof(uint64_t) * words);
+    if (map == NULL)
+        return RC_WRITE_FAILED;
+    memset(&map[file_info->freeMapWords], 0, sizeof(uint64_t) * (words - file_info->freeMapWords));
+    file_info->freeMap = map;
+
+    int old_summary = FREE_SUMMARY_WORDS(file_info->freeMapWords);
+    int summary_words = FREE_SUMMARY_WORDS(words);
+    if (summary_words > old_summary)
+    {
+        uint64_t *summary = (uint64_t *)realloc(file_info->freeSummary, sizeof(uint64_t) * summary_words);
+        if (summary == NULL)
+            return RC_WRITE_FAILED;
+        memset(&summary[old_summary], 0, sizeof(uint64_t) * (summary_words - old_summary));
+        file_info->freeSummary = summary;
+    }
+    file_info->freeMapWords = words;
+    return RC_OK;
+}
+
+// build the summary of a free page bitmap that was just loaded
+static RC buildFreeSummary (SM_FileInfo *file_info)
+{
+    if (file_info->freeMapWords == 0)
+        return RC_OK;
+    file_info->freeSummary = (uint64_t *)calloc(FREE_SUMMARY_WORDS(file_info->freeMapWords), sizeof(uint64_t));
+    if (file_info->freeSummary == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    for (int w = 0; w < file_info->freeMapWords; w++)
+        updateFreeSummary(file_info, w);
+    return RC_OK;
+}
+
+// forget the free pages from page numPages on. returns the first word that changed through lastWord,
+// the words the caller has to store; firstWord > lastWord if nothing changed
+static void trimFreeMap (SM_FileInfo *file_info, int numPages, int *firstWord, int *lastWord)
+{
+    *firstWord = numPages / 64;
+    *lastWord = -1;
+    for (int w = *firstWord; w < file_info->freeMapWords; w++)
+    {
+        uint64_t keep = (w == numPages / 64) ? (((uint64_t)1 << (numPages % 64)) - 1) : 0;
+        uint64_t dropped = file_info->freeMap[w] & ~keep;
+        if (dropped == 0)
+            continue;
+        file_info->numFreePages -= __builtin_popcountll(dropped);
+        file_info->freeMap[w] &= keep;
+        updateFreeSummary(file_info, w);
+        *lastWord = w;
+    }
+}
+
+// name of the file that holds the free page bitmap of the page file fileName
+static void freeMapName (const char *fileName, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s.fsm", fileName);
+}
+
+static void removeFreeMap (const char *fileName)
+{
+    char name[PATH_MAX];
+    freeMapName(fileName, name, sizeof(name));
+    unlink(name);
+}
+
+// read the bitmap file of a page file on disk, if there is one
+static RC loadDiskFreeMap (SM_FileInfo *file_info, char *fileName)
+{
+    char name[PATH_MAX];
+    freeMapName(fileName, name, sizeof(name));
+    file_info->fsmName = strdup(name);
+    if (file_info->fsmName == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // nothing was freed yet, the first freePage makes the file
+    int fd = open(name, O_RDWR);
+    if (fd < 0)
+        return RC_OK;
+    file_info->fsmFd = fd;
+
+    struct stat fsm_stat;
+    if (fstat(fd, &fsm_stat) != 0)
+        return RC_FILE_NOT_FOUND;
+    int words = fsm_stat.st_size / sizeof(uint64_t);
+    if (words == 0)
+        return RC_OK;
+
+    file_info->freeMap = (uint64_t *)calloc(words, sizeof(uint64_t));
+    if (file_info->freeMap == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    file_info->freeMapWords = words;
+    if (preadFully(fd, (char *)file_info->freeMap, words * sizeof(uint64_t), 0) != (ssize_t)(words * sizeof(uint64_t)))
+        return RC_INVALID_PAGE_FILE;
+    return RC_OK;
+}
+
+static RC storeDiskFreeMap (SM_FileInfo *file_info, int firstWord, int numWords)
+{
+    if (file_info->fsmFd < 0)
+    {
+        file_info->fsmFd = open(file_info->fsmName, O_RDWR | O_CREAT, 0644);
+        if (file_info->fsmFd < 0)
+            return RC_WRITE_FAILED;
+    }
+    if (pwriteFully(file_info->fsmFd, (char *)&file_info->freeMap[firstWord], numWords * sizeof(uint64_t),
+                    (off_t)firstWord * sizeof(uint64_t)) != 0)
+        return RC_WRITE_FAILED;
+
+    // durable together with the page writes of the file
+    if (file_info->syncPolicy != SM_SYNC_NONE && dataSync(file_info->fsmFd) != 0)
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+
+// storage manager doesn't require any initialization. It takes no paramneters, return nothing
+extern void initStorageManager (void)
+{
+	printf("Assignment group 26\n");
+	printf("Sathvika Sagar Tavitireddy , CWID : A20560449\n");
+	printf("Chaitanya Durgesh Nynavarapu,  CWID : A20561894\n");
+
+    printf("--------Initializing storage manager ---------\n");
+}
+
+
+// allocate one zero filled page of PAGE_SIZE bytes whose address is SM_PAGE_ALIGNMENT aligned,
+// as required for O_DIRECT I/O. returns NULL if the allocation fails. release it with freeAlignedPage
+extern SM_PageHandle allocAlignedPage (void)
+{
+    return allocAlignedBuffer(PAGE_SIZE);
+}
+
+// like allocAlignedPage, for a page of size bytes (e.g. the pageSize of a file handle)
+extern SM_PageHandle allocAlignedBuffer (int size)
+{
+    void *page = NULL;
+    if (size <= 0 || posix_memalign(&page, SM_PAGE_ALIGNMENT, size) != 0)
+        return NULL;
+
+    memset(page, 0, size);
+    return (SM_PageHandle)page;
+}
+
+// release a page allocated with allocAlignedPage or allocAlignedBuffer
+extern void freeAlignedPage (SM_PageHandle page)
+{
+    free(page);
+}
+
+
+// remove segment files "<fileName>.seg1", "<fileName>.seg2", ... left over from a segmented page file
+static void removeSegments (const char *fileName)
+{
+    char name[PATH_MAX];
+    for (int segment = 1; ; segment++)
+    {
+        segmentName(fileName, segment, name, sizeof(name));
+        if (unlink(name) != 0)
+            break;
+    }
+}
+
+
+// create a page file with given fileName as input parameters
+extern RC createPageFile (char *fileName)
+{
+    return createPageFileWithPageSize(fileName, PAGE_SIZE);
+}
+
+
+// 1 if pageSize is a power of two between SM_MIN_PAGE_SIZE and SM_MAX_PAGE_SIZE
+static int validPageSize (int pageSize)
+{
+    return pageSize >= SM_MIN_PAGE_SIZE && pageSize <= SM_MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+// create a page file whose pages are pageSize bytes, a power of two between SM_MIN_PAGE_SIZE and SM_MAX_PAGE_SIZE.
+// the page size is recorded in the header block, so every later open uses it
+extern RC createPageFileWithPageSize (char *fileName, int pageSize)
+{
+    if (fileName == NULL)
+        return RC_FILE_NOT_FOUND;
+    if (!validPageSize(pageSize))
+        return RC_INVALID_PAGE_FILE;
+
+    return defaultBackend->create(fileName, pageSize);
+}
+
+// create a compressed page file: every page is compressed on write into an extent of its own and
+// decompressed on read, pages of zeros take no space at all. the file is opened like any other page file.
+// the memory backend keeps pages uncompressed, it creates an ordinary file
+extern RC createCompressedPageFile (char *fileName, int pageSize)
+{
+    if (fileName == NULL)
+        return RC_FILE_NOT_FOUND;
+    if (!validPageSize(pageSize))
+        return RC_INVALID_PAGE_FILE;
+
+    if (defaultBackend == &memoryBackend)
+        return memoryBackend.create(fileName, pageSize);
+    return compressedBackend.create(fileName, pageSize);
+}
+
+// create a page file on disk: the header block followed by one empty page
+static RC createDiskFile (char *fileName, int pageSize)
+{
+    // create (or truncate) the file "filename" for reading and writing
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    //check if the file is opened
+    if(fd < 0)
+    {
+        return RC_FILE_NOT_FOUND;   //if file opening is failed
+    }
+    
+    // allocate the header block followed by one empty page (initializes memory with zero('\0') bytes)
+    SM_PageHandle empty_page = allocAlignedBuffer(SM_HEADER_SIZE + pageSize);
+
+    if(empty_page == NULL)
+    {
+        // if failed to allocate memory
+        close(fd);      // close the file to prevent resource leaks
+        return RC_WRITE_FAILED; 
+    }
+
+    SM_FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SM_FILE_MAGIC, sizeof(header.magic));
+    header.version = 1;
+    header.pageSize = pageSize;
+    memcpy(empty_page, &header, sizeof(header));
+
+    // write the header and the empty page as page 0 of the file
+    if (pwriteFully(fd, empty_page, SM_HEADER_SIZE + pageSize, 0) != 0) 
+    {
+        //if the whole page could not be written, write operation is not successful
+        freeAlignedPage(empty_page);     // free the allocated memory
+        close(fd);            // close the file to prevent resource leaks
+        return RC_WRITE_FAILED;
+    }
+
+    // if everything succeeds, cleanup the allocated memory and return ok
+    freeAlignedPage(empty_page);
+    close(fd);
+
+    // segments and free pages of an earlier file with the same name must not become part of the new one
+    removeSegments(fileName);
+    removeFreeMap(fileName);
+
+    return RC_OK;
+}
+
+
+// create a compressed page file on disk: the header block and the map of its one page, a page of zeros
+static RC createCompressedDiskFile (char *fileName, int pageSize)
+{
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return RC_FILE_NOT_FOUND;
+
+    SM_PageHandle block = allocAlignedBuffer(SM_HEADER_SIZE + SM_EXTENT_ALIGN);
+    if (block == NULL)
+    {
+        close(fd);
+        return RC_WRITE_FAILED;
+    }
+
+    SM_FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SM_FILE_MAGIC, sizeof(header.magic));
+    header.version = SM_FORMAT_VERSION;
+    header.pageSize = pageSize;
+    header.flags = SM_FORMAT_COMPRESSED;
+    header.numPages = 1;
+    header.mapOffset = SM_HEADER_SIZE;
+    memcpy(block, &header, sizeof(header));
+
+    // the map entry of page 0 stays zero: a page of zeros without an extent
+    RC rc = (pwriteFully(fd, block, SM_HEADER_SIZE + SM_EXTENT_ALIGN, 0) == 0) ? RC_OK : RC_WRITE_FAILED;
+    freeAlignedPage(block);
+    close(fd);
+
+    removeSegments(fileName);
+    removeFreeMap(fileName);
+    return rc;
+}
+
+
+// read the header block of the file open as file_info->fd (fileSize bytes long) into header and set pageSize and headerSize.
+// a file that does not start with a header is a PAGE_SIZE page file without header (header is all zero then)
+static RC readFileHeader (SM_FileInfo *file_info, off_t fileSize, SM_FileHeader *header)
+{
+    file_info->pageSize = PAGE_SIZE;
+    file_info->headerSize = 0;
+    memset(header, 0, sizeof(*header));
+    if (fileSize < SM_HEADER_SIZE)
+        return RC_OK;
+
+    SM_PageHandle block = allocAlignedBuffer(SM_HEADER_SIZE);
+    if (block == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (preadFully(file_info->fd, block, SM_HEADER_SIZE, 0) != SM_HEADER_SIZE)
+    {
+        freeAlignedPage(block);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    SM_FileHeader found;
+    memcpy(&found, block, sizeof(found));
+    freeAlignedPage(block);
+    if (memcmp(found.magic, SM_FILE_MAGIC, sizeof(found.magic)) != 0)
+        return RC_OK;
+
+    if (found.version > SM_FORMAT_VERSION || found.pageSize < SM_MIN_PAGE_SIZE || found.pageSize > SM_MAX_PAGE_SIZE
+        || (found.pageSize & (found.pageSize - 1)) != 0 || (found.flags & ~SM_FORMAT_COMPRESSED) != 0)
+        return RC_INVALID_PAGE_FILE;
+
+    *header = found;
+    file_info->pageSize = found.pageSize;
+    file_info->headerSize = SM_HEADER_SIZE;
+    return RC_OK;
+}
+
+
+// open the segments of a segmented page file whose segment 0 (already open as file_info->fd) has size fileSize.
+// the segments are fileName, fileName.seg1, ...; all segments before the last one are full.
+// returns the total number of pages in totalPages
+static RC openSegmentedFile (SM_FileInfo *file_info, char *fileName, off_t fileSize, int *totalPages)
+{
+    file_info->baseName = strdup(fileName);
+    file_info->segFds = (int *)malloc(sizeof(int));
+    if (file_info->baseName == NULL || file_info->segFds == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    file_info->segFds[0] = file_info->fd;
+    file_info->numSegments = 1;
+
+    // segment 0 of a segmented file never holds more than one segment
+    if (fileSize > segmentSize(file_info, 0, SM_SEGMENT_PAGES))
+        return RC_INVALID_PAGE_FILE;
+
+    *totalPages = (fileSize - file_info->headerSize) / file_info->pageSize;
+    file_info->allocatedPages = 0;     // preallocation is tracked again from here on
+    while (fileSize == segmentSize(file_info, file_info->numSegments - 1, SM_SEGMENT_PAGES))
+    {
+        // a full segment: the file continues in the next one, if it exists
+        char name[PATH_MAX];
+        segmentName(fileName, file_info->numSegments, name, sizeof(name));
+        if (access(name, F_OK) != 0)
+            break;
+
+        RC rc = openSegments(file_info, file_info->numSegments + 1, 0);
+        if (rc != RC_OK)
+            return rc;
+
+        struct stat segment_stat;
+        if (fstat(file_info->segFds[file_info->numSegments - 1], &segment_stat) != 0)
+            return RC_FILE_NOT_FOUND;
+        fileSize = segment_stat.st_size;
+        if (fileSize > segmentSize(file_info, file_info->numSegments - 1, SM_SEGMENT_PAGES))
+            return RC_INVALID_PAGE_FILE;
+        *totalPages += fileSize / file_info->pageSize;
+    }
+    return RC_OK;
+}
+
+
+// open an existing pagefile
+extern RC openPageFile (char *fileName, SM_FileHandle *fHandle)
+{
+    return openPageFileFlags(fileName, fHandle, SM_OPEN_DEFAULT);
+}
+
+
+// open an existing pagefile with a combination of SM_OPEN_* flags
+//  SM_OPEN_DIRECT: bypass the OS page cache (O_DIRECT). filesystems that do not support it (e.g. tmpfs) fall back to buffered I/O
+//  SM_OPEN_MAPPED: map the whole file into memory (see openPageFileMapped)
+//  SM_OPEN_SEGMENTED: the file is made of segment files of SM_SEGMENT_PAGES pages each (cannot be combined with SM_OPEN_MAPPED)
+// SM_OPEN_MAPPED opens the file with the mmap backend, whatever backend setStorageBackend chose for files on disk.
+// the stdio backend ignores SM_OPEN_DIRECT and SM_OPEN_SEGMENTED, the memory backend ignores all flags
+extern RC openPageFileFlags (char *fileName, SM_FileHandle *fHandle, int flags)
+{
+    if (fileName == NULL || fHandle == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    const SM_Backend *backend = defaultBackend;
+    if (backend == &memoryBackend)
+        flags = SM_OPEN_DEFAULT;
+    else if (backend == &stdioBackend && !(flags & SM_OPEN_MAPPED))
+        flags = SM_OPEN_DEFAULT;
+    else if (backend == &mmapBackend || (flags & SM_OPEN_MAPPED))
+    {
+        backend = &mmapBackend;
+        flags |= SM_OPEN_MAPPED;
+    }
+
+    if ((flags & SM_OPEN_MAPPED) && (flags & SM_OPEN_SEGMENTED))
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)calloc(1, sizeof(SM_FileInfo));
+    if (file_info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    file_info->backend = backend;
+    file_info->fd = -1;
+    file_info->fsmFd = -1;
+    file_info->autoAdvice = 1;
+    file_info->accessPattern = SM_ADVICE_NORMAL;
+    file_info->lastReadPage = -1;
+    file_info->flags = flags;
+    file_info->growPolicy = SM_GROW_PREALLOCATE;
+    file_info->extentPages = SM_DEFAULT_EXTENT_PAGES;
+
+    int total_no_of_pages = 0;
+    RC rc = backend->open(file_info, fileName, &total_no_of_pages);
+    if (rc != RC_OK)
+    {
+        free(file_info);
+        return rc;
+    }
+
+    // a compressed file is read and written through its extent map, whichever disk backend opened it
+    if (file_info->extents != NULL)
+        file_info->backend = &compressedBackend;
+
+    // free pages past the end of file (left by a crash during truncation) do not count
+    int first_word, last_word;
+    rc = file_info->backend->loadFreeMap(file_info, fileName);
+    if (rc == RC_OK)
+        rc = buildFreeSummary(file_info);
+    if (rc != RC_OK)
+    {
+        file_info->backend->close(file_info);
+        free(file_info->freeMap);
+        free(file_info->freeSummary);
+        free(file_info);
+        return rc;
+    }
+    for (int w = 0; w < file_info->freeMapWords; w++)
+        file_info->numFreePages += __builtin_popcountll(file_info->freeMap[w]);
+    trimFreeMap(file_info, total_no_of_pages, &first_word, &last_word);
+
+    // writes are not synced until setSyncPolicy asks for it
+    file_info->syncPolicy = SM_SYNC_NONE;
+    file_info->syncIntervalUs = SM_DEFAULT_SYNC_INTERVAL_US;
+    file_info->syncBatch = SM_DEFAULT_SYNC_BATCH;
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&file_info->syncLock, NULL);
+    pthread_cond_init(&file_info->syncCond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    // store the filename in filehandle
+    fHandle->fileName = fileName;
+
+    //store the total number of pages in file and their size to filehandle
+    fHandle->totalNumPages = total_no_of_pages;
+    fHandle->pageSize = file_info->pageSize;
+
+    //set the current position to first page
+    fHandle->curPagePos = 0;
+
+    //store the file information (and any additional information about file that might be needed)
+    fHandle->mgmtInfo = file_info;
+
+    return RC_OK;
+}
+
+// close the descriptors of a file on disk and release what openDiskFile allocated
+static void closeDiskFile (SM_FileInfo *file_info)
+{
+    if (file_info->fd >= 0)
+        close(file_info->fd);
+    for (int i = 1; i < file_info->numSegments; i++)
+        close(file_info->segFds[i]);
+    if (file_info->fsmFd >= 0)
+        close(file_info->fsmFd);
+    free(file_info->segFds);
+    free(file_info->baseName);
+    free(file_info->fsmName);
+    freeExtentMap(file_info->extents);
+    file_info->extents = NULL;
+    file_info->fsmFd = -1;
+    file_info->fsmName = NULL;
+    file_info->fd = -1;
+    file_info->segFds = NULL;
+    file_info->numSegments = 0;
+    file_info->baseName = NULL;
+}
+
+// open a page file on disk with the SM_OPEN_* flags in file_info->flags and return its number of pages
+static RC openDiskFile (SM_FileInfo *file_info, char *fileName, int *totalPages)
+{
+    int flags = file_info->flags;
+
+    //open an existing file for reading and writing (does not create it)
+    int open_flags = O_RDWR;
+    if (flags & SM_OPEN_DIRECT)
+        open_flags |= O_DIRECT;
+
+    int fd = open(fileName, open_flags);
+
+    // O_DIRECT is rejected with EINVAL by filesystems that cannot do it, use buffered I/O there
+    if (fd < 0 && errno == EINVAL && (flags & SM_OPEN_DIRECT))
+    {
+        file_info->flags &= ~SM_OPEN_DIRECT;
+        fd = open(fileName, O_RDWR);
+    }
+
+    if(fd < 0)
+    {
+        return RC_FILE_NOT_FOUND;   //if file opening is failed
+    }
+    file_info->fd = fd;
+
+    // the file size comes from fstat, no seeking is needed
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0)
+    {
+        closeDiskFile(file_info);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    SM_FileHeader header;
+    RC rc = readFileHeader(file_info, file_stat.st_size, &header);
+    if (rc != RC_OK)
+    {
+        closeDiskFile(file_info);
+        return rc;
+    }
+
+    // a compressed file is one file of variable size extents: it is never segmented or read with direct I/O
+    if (header.flags & SM_FORMAT_COMPRESSED)
+    {
+        if (file_info->flags & SM_OPEN_DIRECT)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+        file_info->flags = SM_OPEN_DEFAULT;
+
+        rc = loadExtentMap(file_info, &header);
+        if (rc != RC_OK)
+        {
+            closeDiskFile(file_info);
+            return rc;
+        }
+        *totalPages = header.numPages;
+        file_info->allocatedPages = *totalPages;
+        return RC_OK;
+    }
+
+    // total number of pages that are stored on file can calculated by didviding file size (without header) by page size
+    *totalPages = (file_stat.st_size - file_info->headerSize) / file_info->pageSize;
+
+    // space preallocated by an earlier growth (beyond the end of file) shows up in the block count
+    file_info->allocatedPages = ((off_t)file_stat.st_blocks * 512 - file_info->headerSize) / file_info->pageSize;
+    if (file_info->allocatedPages < 0)
+        file_info->allocatedPages = 0;
+
+    if (flags & SM_OPEN_SEGMENTED)
+    {
+        rc = openSegmentedFile(file_info, fileName, file_stat.st_size, totalPages);
+        if (rc != RC_OK)
+        {
+            closeDiskFile(file_info);
+            return rc;
+        }
+    }
+
+    return RC_OK;
+}
+
+
+// open an existing pagefile and map all of its pages into memory.
+// in this mode readBlock/writeBlock copy from/to the mapping and getBlockPointer gives direct access to a page
+extern RC openPageFileMapped (char *fileName, SM_FileHandle *fHandle)
+{
+    return openPageFileFlags(fileName, fHandle, SM_OPEN_MAPPED);
+}
+
+
+//close an open page file
+extern RC closePageFile (SM_FileHandle *fHandle)
+{
+    // check if filehandle is valid to prevent operations on uninitialized handle
+    if(fHandle == NULL)
+    {
+        //file handle = null indicates that file handle is not valid
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    // if file handle is initilaized
+    // cast the file handle mgmtinfo(additional file info) to the file information
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+
+    // if the file is open then let its backend close it and release the file information
+    if (file_info != NULL) {
+        file_info->backend->close(file_info);
+        pthread_mutex_destroy(&file_info->syncLock);
+        pthread_cond_destroy(&file_info->syncCond);
+        free(file_info->freeMap);
+        free(file_info->freeSummary);
+        free(file_info);
+    }
+
+    // after closing the file, set all fields of file handle to initial values
+    // to ensure this file handle cannot be used without intializing it again
+    fHandle->fileName = NULL;
+    fHandle->totalNumPages = 0;
+    fHandle->curPagePos = 0;
+    fHandle->mgmtInfo = NULL;
+
+    //return ok , if all the operations are successful
+    return RC_OK;
+}
+
+
+// destroy/delete a page file
+extern RC destroyPageFile (char *fileName)
+{
+    //check if filename is valid. If not, return error 
+    if(fileName == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    return defaultBackend->destroy(fileName);
+}
+
+// remove a page file on disk with all of its segments
+static RC destroyDiskFile (char *fileName)
+{
+    // if filename exists, then try to remove the file
+    if (remove(fileName) != 0)     // remove() returns 0 if successful, returns non zero if failed
+    {
+        // If remove fails, return an error
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // a segmented page file also owns its further segments, and every file its free page bitmap
+    removeSegments(fileName);
+    removeFreeMap(fileName);
+
+    // if remove operation is successful , return ok
+    return RC_OK;
+}
+
+
+// watch the reads of a file and advise the kernel: a run of adjacent reads (a scan) switches to sequential access
+// and keeps SM_READAHEAD_PAGES pages announced ahead of it; a run of scattered reads (index probes) switches
+// to random access, which turns readahead off. the fields are atomic; threads reading the same handle at once
+// only blur the picture, and the exchange of accessPattern makes one of them give each advice
+static void detectAccessPattern (SM_FileInfo *file_info, int pageNum, int numPages, int totalPages)
+{
+    int lastReadPage = LOAD_RELAXED(file_info->lastReadPage);
+    if (!LOAD_RELAXED(file_info->autoAdvice) || pageNum == lastReadPage)
+        return;
+
+    int sequentialReads = 0, scatteredReads = 0;
+    if (pageNum == lastReadPage + 1)
+    {
+        sequentialReads = __atomic_add_fetch(&file_info->sequentialReads, 1, __ATOMIC_RELAXED);
+        STORE_RELAXED(file_info->scatteredReads, 0);
+    }
+    else
+    {
+        scatteredReads = __atomic_add_fetch(&file_info->scatteredReads, 1, __ATOMIC_RELAXED);
+        STORE_RELAXED(file_info->sequentialReads, 0);
+        STORE_RELAXED(file_info->readaheadEnd, 0);     // a later scan starts its own window
+    }
+    STORE_RELAXED(file_info->lastReadPage, pageNum + numPages - 1);
+
+    if (sequentialReads >= SM_SEQUENTIAL_TRIGGER)
+    {
+        if (__atomic_exchange_n(&file_info->accessPattern, SM_ADVICE_SEQUENTIAL, __ATOMIC_RELAXED) != SM_ADVICE_SEQUENTIAL)
+            file_info->backend->advise(file_info, SM_ADVICE_SEQUENTIAL, 0, totalPages);
+
+        // announce the next stretch whenever less than half a window is left ahead of the scan
+        int next = pageNum + numPages;
+        int readaheadEnd = LOAD_RELAXED(file_info->readaheadEnd);
+        if (readaheadEnd - next < SM_READAHEAD_PAGES / 2 && next < totalPages)
+        {
+            int start = (readaheadEnd > next) ? readaheadEnd : next;
+            int end = (totalPages - next > SM_READAHEAD_PAGES) ? next + SM_READAHEAD_PAGES : totalPages;
+            if (end > start)
+                file_info->backend->advise(file_info, SM_ADVICE_WILLNEED, start, end - start);
+            STORE_RELAXED(file_info->readaheadEnd, end);
+        }
+    }
+    else if (scatteredReads >= SM_RANDOM_TRIGGER &&
+             __atomic_exchange_n(&file_info->accessPattern, SM_ADVICE_RANDOM, __ATOMIC_RELAXED) != SM_ADVICE_RANDOM)
+    {
+        file_info->backend->advise(file_info, SM_ADVICE_RANDOM, 0, totalPages);
+    }
+}
+
+// read the block at pageNum position from a file and store its content
+extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    // check if filehandle is valid to prevent operations on uninitialized handle
+    if(fHandle == NULL)
+    {
+        //file handle = null indicates that file handle is not valid
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    //retrieve file information from filehandle's management info
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    
+    //check if the file is open
+    if(file_info == NULL)
+    {
+        return RC_FILE_NOT_FOUND;   // if not valid
+    }
+
+    //check if pageNum is valid. It should be >= 0 and less than filehandle's total number of pages
+    if(pageNum < 0 || pageNum >= LOAD_RELAXED(fHandle->totalNumPages))
+        return RC_READ_NON_EXISTING_PAGE;
+
+    detectAccessPattern(file_info, pageNum, 1, LOAD_RELAXED(fHandle->totalNumPages));
+
+    //read the page through the backend of the file and store it into memeory pointed my memPage
+    SM_IOMark mark;
+    beginIO(&mark);
+    RC rc = file_info->backend->transfer(file_info, pageNum, 1, &memPage, 0);
+    chargeIO(file_info, &mark, SM_CHARGE_READ, pageNum, 1);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+
+    //update current page position in the file handle after successful read operation
+    STORE_RELAXED(fHandle->curPagePos, pageNum);
+    return RC_OK;
+}
+
+
+//returns an int, which is current block page position
+extern int getBlockPos (SM_FileHandle *fHandle)
+{
+    // check if filehandle is valid to prevent operations on uninitialized handle
+    if(fHandle == NULL || fHandle->mgmtInfo == NULL)
+    {
+        //file handle = null indicates that file handle is not valid
+        return -1;
+    }
+
+    return LOAD_RELAXED(fHandle->curPagePos);
+}
+
+// returns a pointer to page pageNum inside the mapping of a file opened with openPageFileMapped,
+// or inside the page store of the memory backend (no copy is made).
+// returns NULL if the backend of the file cannot give such a pointer or the page does not exist.
+// the pointer of a mapped file stays valid until the file grows (appendEmptyBlock/ensureCapacity) or is closed,
+// the pointer of a memory file until the page is truncated away or the file is destroyed
+extern SM_PageHandle getBlockPointer (int pageNum, SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return NULL;
+
+    if (pageNum < 0 || pageNum >= LOAD_RELAXED(fHandle->totalNumPages))
+        return NULL;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    if (file_info->backend->pagePointer == NULL)
+        return NULL;
+    return file_info->backend->pagePointer(file_info, pageNum);
+}
+
+// read the first page of file
+extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    int firstPageNum = 0; //indicates first page
+    //pass this pageNum as input parameter to readBlock() function
+    return readBlock(firstPageNum, fHandle, memPage);
+}
+
+
+//read the previous page of file handles curPagePos
+extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    // check if filehandle is valid to prevent operations on uninitialized handle
+    if(fHandle == NULL)
+    {
+        //file handle = null indicates that file handle is not valid
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    int prevPageNum = LOAD_RELAXED(fHandle->curPagePos) - 1;
+
+    //pass this pageNum as input parameter to readBlock() function
+    return readBlock(prevPageNum, fHandle, memPage);
+}
+
+
+//read the current page 
+extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    // check if filehandle is valid to prevent operations on uninitialized handle
+    if(fHandle == NULL)
+    {
+        //file handle = null indicates that file handle is not valid
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    int currPageNum = LOAD_RELAXED(fHandle->curPagePos);
+
+    //pass this pageNum as input parameter to readBlock() function
+    return readBlock(currPageNum, fHandle, memPage);
+}
+
+
+//read the next page of file handles curPagePos
+extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    // check if filehandle is valid to prevent operations on uninitialized handle
+    if(fHandle == NULL)
+    {
+        //file handle = null indicates that file handle is not valid
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    int currPageNum = LOAD_RELAXED(fHandle->curPagePos) + 1;
+
+    //pass this pageNum as input parameter to readBlock() function
+    return readBlock(currPageNum, fHandle, memPage);
+}
+
+
+//read the last page of file handles curPagePos
+extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    // check if filehandle is valid to prevent operations on uninitialized handle
+    if(fHandle == NULL)
+    {
+        //file handle = null indicates that file handle is not valid
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    int lastPageNum = LOAD_RELAXED(fHandle->totalNumPages) - 1;
+    //pass this pageNum as input parameter to readBlock() function
+    return readBlock(lastPageNum, fHandle, memPage);
+}
+
+// read numPages adjacent pages starting at startPage into the buffers pages[0..numPages-1].
+// a whole run of pages is read with one vectored system call instead of one call per page
+extern RC readBlockRange (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *pages)
+{
+    // check if filehandle is valid to prevent operations on uninitialized handle
+    if (fHandle == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    if (file_info == NULL || pages == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    // every page of the range has to exist
+    if (startPage < 0 || numPages <= 0 || startPage + numPages > LOAD_RELAXED(fHandle->totalNumPages))
+        return RC_READ_NON_EXISTING_PAGE;
+
+    detectAccessPattern(file_info, startPage, numPages, LOAD_RELAXED(fHandle->totalNumPages));
+
+    SM_IOMark mark;
+    beginIO(&mark);
+    RC rc = file_info->backend->transfer(file_info, startPage, numPages, pages, 0);
+    chargeIO(file_info, &mark, SM_CHARGE_READ, startPage, numPages);
+    if (rc != RC_OK)
+        return rc;
+
+    // like readBlock, the current position is the last page read
+    STORE_RELAXED(fHandle->curPagePos, startPage + numPages - 1);
+    return RC_OK;
+}
+
+// write a page to disk
+extern RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) 
+{
+    // Check if file handle is valid
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL) 
+    {
+        return RC_FILE_NOT_FOUND;   //if file handle is invalid
+    }
+
+    // Check if the given pageNum is valid
+    if (pageNum < 0 || pageNum >= LOAD_RELAXED(fHandle->totalNumPages)) 
+    {
+        return RC_WRITE_FAILED;    // Writing to a non-existing page is considered a failure
+    }
+
+    // Write the block from the memory buffer through the backend of the file
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    SM_IOMark mark;
+    beginIO(&mark);
+    RC rc = file_info->backend->transfer(file_info, pageNum, 1, &memPage, 1);
+    if (rc == RC_OK) 
+    {
+        // Update the current page position in file handle
+        STORE_RELAXED(fHandle->curPagePos, pageNum);
+
+        // Make the write durable if the sync policy asks for it
+        rc = syncAfterWrite(file_info, file_info->syncPolicy);
+    }
+    chargeIO(file_info, &mark, SM_CHARGE_WRITE, pageNum, 1);
+    return rc;
+}
+
+
+//write the current page
+extern RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) 
+{
+    // Check if file handle is valid
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    // Get the current page position
+    int curPage = LOAD_RELAXED(fHandle->curPagePos);
+
+    // Call the writeBlock function to write the current block
+    return writeBlock(curPage, fHandle, memPage);
+}
+
+
+// write the buffers pages[0..numPages-1] to numPages adjacent pages starting at startPage,
+// with one vectored system call per run of pages
+extern RC writeBlockRange (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *pages)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_NOT_FOUND;
+    return writeBlockRangeSync(startPage, numPages, fHandle, pages, ((SM_FileInfo *)fHandle->mgmtInfo)->syncPolicy);
+}
+
+
+// like writeBlockRange, but made durable as syncPolicy asks instead of the policy of the file.
+// lets a caller write several ranges with SM_SYNC_NONE and make them durable with one syncPageFile
+extern RC writeBlockRangeSync (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *pages, int syncPolicy)
+{
+    // Check if file handle is valid
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL || pages == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    // every page of the range has to exist
+    if (startPage < 0 || numPages <= 0 || startPage + numPages > LOAD_RELAXED(fHandle->totalNumPages))
+        return RC_WRITE_FAILED;
+    if (syncPolicy != SM_SYNC_NONE && syncPolicy != SM_SYNC_WRITE && syncPolicy != SM_SYNC_GROUP)
+        return RC_WRITE_FAILED;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    SM_IOMark mark;
+    beginIO(&mark);
+    RC rc = file_info->backend->transfer(file_info, startPage, numPages, pages, 1);
+    if (rc == RC_OK)
+    {
+        // like writeBlock, the current position is the last page written; the whole range needs a single sync
+        STORE_RELAXED(fHandle->curPagePos, startPage + numPages - 1);
+        rc = syncAfterWrite(file_info, syncPolicy);
+    }
+    chargeIO(file_info, &mark, SM_CHARGE_WRITE, startPage, numPages);
+    return rc;
+}
+
+
+//append a new last page that is filled with zero bytes and increase total number of pages by one.
+extern RC appendEmptyBlock(SM_FileHandle *fHandle) 
+{
+
+    // Check if file handle is valid
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    // the new page lies past the old end of file, so it reads as zero bytes without writing anything
+    return growPageFile(fHandle, fHandle->totalNumPages + 1);
+}
+
+//ensures the file has at least the specified number of pages. 
+//If the file already has enough pages, it does nothing. 
+//If not, it grows the file to the desired capacity in one step.
+extern RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) 
+{
+    // Check if file handle is valid
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    // If no additional pages are needed, return success
+    if (numberOfPages <= fHandle->totalNumPages)
+        return RC_OK;
+
+    return growPageFile(fHandle, numberOfPages);
+}
+
+// choose how a page file grows:
+//  SM_GROW_PREALLOCATE: reserve disk space extentPages pages at a time with fallocate (default, 1 MB extents)
+//  SM_GROW_SPARSE: only move the end of file with ftruncate, blocks are allocated when pages are written
+// extentPages <= 0 selects the default extent size
+extern RC setGrowthPolicy (SM_FileHandle *fHandle, int policy, int extentPages)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    file_info->growPolicy = policy;
+    file_info->extentPages = (extentPages > 0) ? extentPages : SM_DEFAULT_EXTENT_PAGES;
+    return RC_OK;
+}
+
+// shrink a file on disk to numberOfPages pages, removing the segments behind the new end
+static RC shrinkDiskFile (SM_FileInfo *file_info, int numberOfPages)
+{
+    if (file_info->segFds != NULL)
+    {
+        int lastSegment = (numberOfPages - 1) / SM_SEGMENT_PAGES;
+        char name[PATH_MAX];
+        while (file_info->numSegments > lastSegment + 1)
+        {
+            int segment = --file_info->numSegments;
+            close(file_info->segFds[segment]);
+            segmentName(file_info->baseName, segment, name, sizeof(name));
+            if (unlink(name) != 0)
+                return RC_WRITE_FAILED;
+        }
+        if (ftruncate(file_info->segFds[lastSegment], segmentSize(file_info, lastSegment, numberOfPages - lastSegment * SM_SEGMENT_PAGES)) != 0)
+            return RC_WRITE_FAILED;
+    }
+    else if (ftruncate(file_info->fd, pageOffset(file_info, numberOfPages)) != 0)
+        return RC_WRITE_FAILED;
+
+    return RC_OK;
+}
+
+// give the disk blocks of a range of pages back to the filesystem by punching a hole. a hole reads as zeros
+// and costs no device I/O. where the filesystem cannot punch holes the pages are overwritten with zeros
+static RC discardDiskPages (SM_FileInfo *file_info, int startPage, int numPages)
+{
+    int count;
+    for (int page = startPage; page < startPage + numPages; page += count)
+    {
+        count = startPage + numPages - page;
+        if (count > pagesLeftInSegment(file_info, page))
+            count = pagesLeftInSegment(file_info, page);
+
+        off_t offset;
+        int fd = pageLocation(file_info, page, &offset);
+        if (fd < 0)
+            return RC_WRITE_FAILED;
+        if (!file_info->noPunchHole)
+        {
+            if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, pagesSize(file_info, count)) == 0)
+                continue;
+            if (errno != EOPNOTSUPP)
+                return RC_WRITE_FAILED;
+            file_info->noPunchHole = 1;
+        }
+
+        SM_PageHandle empty_page = allocAlignedBuffer(file_info->pageSize);
+        SM_PageHandle pages[SM_RANGE_MAX_IOV];
+        if (empty_page == NULL)
+            return RC_WRITE_FAILED;
+        for (int i = 0; i < SM_RANGE_MAX_IOV; i++)
+            pages[i] = empty_page;
+
+        RC rc = RC_OK;
+        for (int done = 0; done < count && rc == RC_OK; done += SM_RANGE_MAX_IOV)
+        {
+            int run = (count - done < SM_RANGE_MAX_IOV) ? count - done : SM_RANGE_MAX_IOV;
+            rc = transferBlockRange(file_info, page + done, run, pages, 1);
+        }
+        freeAlignedPage(empty_page);
+        if (rc != RC_OK)
+            return rc;
+    }
+    return RC_OK;
+}
+
+// posix_fadvise advice for SM_ADVICE_*
+static int fileAdvice (int advice)
+{
+    switch (advice)
+    {
+        case SM_ADVICE_SEQUENTIAL:
+            return POSIX_FADV_SEQUENTIAL;
+        case SM_ADVICE_RANDOM:
+            return POSIX_FADV_RANDOM;
+        case SM_ADVICE_WILLNEED:
+            return POSIX_FADV_WILLNEED;
+        case SM_ADVICE_DONTNEED:
+            return POSIX_FADV_DONTNEED;
+        default:
+            return POSIX_FADV_NORMAL;
+    }
+}
+
+// posix_fadvise on a range of pages, segment by segment
+static RC adviseDiskPages (SM_FileInfo *file_info, int advice, int startPage, int numPages)
+{
+    int count;
+    for (int page = startPage; page < startPage + numPages; page += count)
+    {
+        count = startPage + numPages - page;
+        if (count > pagesLeftInSegment(file_info, page))
+            count = pagesLeftInSegment(file_info, page);
+
+        off_t offset;
+        int fd = pageLocation(file_info, page, &offset);
+        if (fd < 0 || posix_fadvise(fd, offset, pagesSize(file_info, count), fileAdvice(advice)) != 0)
+            return RC_FILE_HANDLE_NOT_INIT;
+    }
+    return RC_OK;
+}
+
+// shrink the file to numberOfPages pages (at least one). in a segmented file the segments behind
+// the new end are removed as a whole, which gives their disk space back at once
+extern RC truncatePageFile (int numberOfPages, SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (numberOfPages < 1 || numberOfPages > fHandle->totalNumPages)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    RC rc = file_info->backend->shrink(file_info, numberOfPages);
+    if (rc != RC_OK)
+        return rc;
+
+    // truncation also releases space preallocated beyond the end of file
+    fHandle->totalNumPages = numberOfPages;
+    file_info->allocatedPages = numberOfPages;
+    if (LOAD_RELAXED(fHandle->curPagePos) >= numberOfPages)
+        STORE_RELAXED(fHandle->curPagePos, numberOfPages - 1);
+
+    // pages that no longer exist are not free either
+    int first_word, last_word;
+    trimFreeMap(file_info, numberOfPages, &first_word, &last_word);
+    if (first_word <= last_word)
+        return file_info->backend->storeFreeMap(file_info, first_word, last_word - first_word + 1);
+    return RC_OK;
+}
+
+// discard pages startPage .. startPage + numPages - 1: their disk space goes back to the filesystem
+// (FALLOC_FL_PUNCH_HOLE) while they stay in the file. they read as zeros afterwards, without device I/O;
+// the file size does not change. meant for ranges that no longer hold data, e.g. freed pages
+extern RC discardBlockRange (int startPage, int numPages, SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (startPage < 0 || numPages < 0 || startPage > fHandle->totalNumPages - numPages)
+        return RC_WRITE_FAILED;
+    if (numPages == 0)
+        return RC_OK;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    SM_IOMark mark;
+    beginIO(&mark);
+    RC rc = file_info->backend->discard(file_info, startPage, numPages);
+    if (rc == RC_OK)
+        rc = syncAfterWrite(file_info, file_info->syncPolicy);
+    chargeIO(file_info, &mark, SM_CHARGE_OTHER, 0, 0);
+    return rc;
+}
+
+// tell the kernel how pages startPage .. startPage + numPages - 1 will be read (numPages <= 0: up to the end of file)
+//  SM_ADVICE_NORMAL, SM_ADVICE_SEQUENTIAL, SM_ADVICE_RANDOM: the access pattern (readahead as usual, larger, off).
+//      this also turns the automatic detection in readBlock/readBlockRange off
+//  SM_ADVICE_WILLNEED: start reading the pages into memory now
+//  SM_ADVICE_DONTNEED: the pages are not needed soon, their cached copies can be dropped
+//  SM_ADVICE_AUTO: choose sequential or random access from the reads (the default of an open file)
+extern RC adviseAccess (SM_FileHandle *fHandle, int advice, int startPage, int numPages)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (numPages <= 0)
+        numPages = fHandle->totalNumPages - startPage;
+    if (startPage < 0 || numPages <= 0 || startPage > fHandle->totalNumPages - numPages)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    switch (advice)
+    {
+        case SM_ADVICE_AUTO:
+            STORE_RELAXED(file_info->autoAdvice, 1);
+            STORE_RELAXED(file_info->sequentialReads, 0);
+            STORE_RELAXED(file_info->scatteredReads, 0);
+            return RC_OK;
+        case SM_ADVICE_NORMAL:
+        case SM_ADVICE_SEQUENTIAL:
+        case SM_ADVICE_RANDOM:
+            STORE_RELAXED(file_info->autoAdvice, 0);
+            STORE_RELAXED(file_info->accessPattern, advice);
+            return file_info->backend->advise(file_info, advice, startPage, numPages);
+        case SM_ADVICE_WILLNEED:
+        case SM_ADVICE_DONTNEED:
+            return file_info->backend->advise(file_info, advice, startPage, numPages);
+        default:
+            return RC_FILE_HANDLE_NOT_INIT;
+    }
+}
+
+// choose when writeBlock/writeBlockRange make their data durable:
+//  SM_SYNC_NONE: never, the OS writes the data back in its own time (default)
+//  SM_SYNC_WRITE: every write is followed by its own fdatasync
+//  SM_SYNC_GROUP: writes that finish close together share one fdatasync; a write returns once it is durable.
+//                 a sync waits up to intervalUs microseconds for more writes, or until batchWrites writes wait.
+//                 intervalUs and batchWrites <= 0 keep the current values
+extern RC setSyncPolicy (SM_FileHandle *fHandle, int policy, int intervalUs, int batchWrites)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (policy != SM_SYNC_NONE && policy != SM_SYNC_WRITE && policy != SM_SYNC_GROUP)
+        return RC_WRITE_FAILED;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    pthread_mutex_lock(&file_info->syncLock);
+    file_info->syncPolicy = policy;
+    if (intervalUs > 0)
+        file_info->syncIntervalUs = intervalUs;
+    if (batchWrites > 0)
+        file_info->syncBatch = batchWrites;
+    pthread_mutex_unlock(&file_info->syncLock);
+    return RC_OK;
+}
+
+// make every write done so far durable with one fdatasync, whatever the sync policy
+extern RC syncPageFile (SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    SM_IOMark mark;
+    beginIO(&mark);
+    int failed = file_info->backend->sync(file_info);
+    chargeIO(file_info, &mark, SM_CHARGE_OTHER, 0, 0);
+    return failed ? RC_WRITE_FAILED : RC_OK;
+}
+
+// number of pages the file has disk space reserved for (at least totalNumPages), -1 for an invalid handle
+extern int getAllocatedPages (SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return -1;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    return (file_info->allocatedPages > fHandle->totalNumPages) ? file_info->allocatedPages : fHandle->totalNumPages;
+}
+
+
+// allocate a page: the lowest free page (see freePage) if there is one, otherwise a new page at the end of the file.
+// the page is empty (all zero) either way. its number is returned in pageNum
+extern RC allocatePage (SM_FileHandle *fHandle, int *pageNum)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || pageNum == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    if (file_info->numFreePages == 0)
+    {
+        RC rc = appendEmptyBlock(fHandle);
+        if (rc == RC_OK)
+            *pageNum = fHandle->totalNumPages - 1;
+        return rc;
+    }
+
+    // one bit scan of the summary finds the first word with a free page, one more the page in it.
+    // summary words before the hint are empty, so the search does not start over at page 0
+    int summary = file_info->freeHint;
+    while (file_info->freeSummary[summary] == 0)
+        summary++;
+    file_info->freeHint = summary;
+    int word = summary * 64 + __builtin_ctzll(file_info->freeSummary[summary]);
+    int page = word * 64 + __builtin_ctzll(file_info->freeMap[word]);
+
+    // freePage discarded the page, so it is empty like a page appended to the file
+    file_info->freeMap[word] &= ~((uint64_t)1 << (page % 64));
+    updateFreeSummary(file_info, word);
+    file_info->numFreePages--;
+    RC rc = file_info->backend->storeFreeMap(file_info, word, 1);
+    if (rc != RC_OK)
+    {
+        // the bitmap on disk still lists the page as free, so does the one in memory
+        file_info->freeMap[word] |= (uint64_t)1 << (page % 64);
+        updateFreeSummary(file_info, word);
+        file_info->numFreePages++;
+        return rc;
+    }
+    *pageNum = page;
+    return RC_OK;
+}
+
+// give page pageNum back to the file, allocatePage hands it out again. the page is discarded (see discardBlockRange),
+// free pages at the end of the file are cut off (except page 0), so the file shrinks. freeing a free page does nothing
+extern RC freePage (int pageNum, SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
+    if (reserveFreeMap(file_info, fHandle->totalNumPages - 1) != RC_OK)
+        return RC_WRITE_FAILED;
+
+    int word = pageNum / 64;
+    uint64_t bit = (uint64_t)1 << (pageNum % 64);
+    if (file_info->freeMap[word] & bit)
+        return RC_OK;
+
+    // the page is empty before it is recorded as free
+    RC rc = file_info->backend->discard(file_info, pageNum, 1);
+    if (rc != RC_OK)
+        return rc;
+    file_info->freeMap[word] |= bit;
+    updateFreeSummary(file_info, word);
+    file_info->numFreePages++;
+    if (word / 64 < file_info->freeHint)
+        file_info->freeHint = word / 64;
+
+    int last = fHandle->totalNumPages;
+    while (last > 1 && (file_info->freeMap[(last - 1) / 64] & ((uint64_t)1 << ((last - 1) % 64))))
+        last--;
+    if (last < fHandle->totalNumPages)
+        return truncatePageFile(last, fHandle);     // also stores the bitmap
+    rc = file_info->backend->storeFreeMap(file_info, word, 1);
+    if (rc != RC_OK)
+    {
+        // the page stays allocated, as the bitmap on disk says
+        file_info->freeMap[word] &= ~bit;
+        updateFreeSummary(file_info, word);
+        file_info->numFreePages--;
+    }
+    return rc;
+}
+
+// number of free pages in the file
+extern int getFreePageCount (SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return -1;
+    return ((SM_FileInfo *)fHandle->mgmtInfo)->numFreePages;
+}
+
+
+// copy the I/O statistics of the file (counted since it was opened or resetIOStats) to stats.
+// comparing ioWaitNs with readNs + writeNs tells whether the I/O was waiting for the device
+// or spent its time in the storage manager (copying, compressing); the histograms show the spread.
+// I/O issued through an SM_AsyncEngine is not counted
+extern RC getIOStats (SM_FileHandle *fHandle, SM_IOStats *stats)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || stats == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // SM_IOStats only holds counters, read them one by one while other threads may still add to them
+    const unsigned long long *from = (const unsigned long long *)&((SM_FileInfo *)fHandle->mgmtInfo)->stats;
+    unsigned long long *to = (unsigned long long *)stats;
+    for (size_t i = 0; i < sizeof(SM_IOStats) / sizeof(unsigned long long); i++)
+        to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+// set all I/O statistics of the file back to zero
+extern RC resetIOStats (SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    unsigned long long *counters = (unsigned long long *)&((SM_FileInfo *)fHandle->mgmtInfo)->stats;
+    for (size_t i = 0; i < sizeof(SM_IOStats) / sizeof(unsigned long long); i++)
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+
+/************************************************************
+ *                    storage backends                      *
+ ************************************************************/
+
+// SM_BACKEND_MMAP: a file on disk with a shared mapping of all its pages
+
+static RC openMappedFile (SM_FileInfo *file_info, char *fileName, int *totalPages)
+{
+    RC rc = openDiskFile(file_info, fileName, totalPages);
+    if (rc != RC_OK || file_info->extents != NULL)
+        return rc;      // a compressed file is used through its extent map, it is not mapped
+
+    // a page file always has at least one page (createPageFile writes page 0), an empty file cannot be mapped
+    if (*totalPages <= 0)
+    {
+        closeDiskFile(file_info);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    rc = remapPageFile(file_info, *totalPages);
+    if (rc != RC_OK)
+        closeDiskFile(file_info);
+    return rc;
+}
+
+static void closeMappedFile (SM_FileInfo *file_info)
+{
+    if (file_info->map != NULL)
+        munmap(file_info->map, file_info->mapSize);
+    file_info->map = NULL;
+    closeDiskFile(file_info);
+}
+
+// pages are copied from/to the mapping, no system call is needed; the kernel writes them back to the file
+static RC transferMappedFile (SM_FileInfo *file_info, int startPage, int numPages, SM_PageHandle *pages, int isWrite)
+{
+    for (int i = 0; i < numPages; i++)
+    {
+        char *page = file_info->map + pageOffset(file_info, startPage + i);
+        if (isWrite)
+            memcpy(page, pages[i], file_info->pageSize);
+        else
+            memcpy(pages[i], page, file_info->pageSize);
+    }
+    return RC_OK;
+}
+
+// the mapping has to cover the new pages as well
+static RC growMappedFile (SM_FileInfo *file_info, int oldPages, int numPages)
+{
+    RC rc = growDiskFile(file_info, oldPages, numPages);
+    if (rc != RC_OK)
+        return rc;
+    return remapPageFile(file_info, numPages);
+}
+
+// the mapping must not reach beyond the new end of file
+static RC shrinkMappedFile (SM_FileInfo *file_info, int numPages)
+{
+    RC rc = remapPageFile(file_info, numPages);
+    if (rc != RC_OK)
+        return rc;
+    return shrinkDiskFile(file_info, numPages);
+}
+
+// the hole punched into the file also clears the shared mapping
+static RC discardMappedPages (SM_FileInfo *file_info, int startPage, int numPages)
+{
+    if (!file_info->noPunchHole)
+        return discardDiskPages(file_info, startPage, numPages);
+
+    for (int i = 0; i < numPages; i++)
+        memset(file_info->map + pageOffset(file_info, startPage + i), 0, file_info->pageSize);
+    return RC_OK;
+}
+
+// the mapping is advised with madvise (from the start of the system page that holds startPage), the file as well
+static RC adviseMappedPages (SM_FileInfo *file_info, int advice, int startPage, int numPages)
+{
+    static const int mapAdvice[] = {
+        [SM_ADVICE_NORMAL] = MADV_NORMAL, [SM_ADVICE_SEQUENTIAL] = MADV_SEQUENTIAL, [SM_ADVICE_RANDOM] = MADV_RANDOM,
+        [SM_ADVICE_WILLNEED] = MADV_WILLNEED, [SM_ADVICE_DONTNEED] = MADV_DONTNEED
+    };
+    long systemPage = sysconf(_SC_PAGESIZE);
+    off_t start = pageOffset(file_info, startPage);
+    off_t end = pageOffset(file_info, startPage + numPages);
+    if (systemPage > 0)
+        start -= start % systemPage;
+
+    if (madvise(file_info->map + start, end - start, mapAdvice[advice]) != 0)
+        return RC_FILE_HANDLE_NOT_INIT;
+    return adviseDiskPages(file_info, advice, startPage, numPages);
+}
+
+static int syncMappedFile (SM_FileInfo *file_info)
+{
+    unsigned long long start = monotonicNs();
+    int result = msync(file_info->map, file_info->mapSize, MS_SYNC);
+    countSyscall(start);
+    threadIO.syncs++;
+    if (result != 0)
+        return -1;
+    return syncDiskFile(file_info);
+}
+
+static char *mappedPagePointer (SM_FileInfo *file_info, int pageNum)
+{
+    return file_info->map + pageOffset(file_info, pageNum);
+}
+
+
+// SM_BACKEND_STDIO: a file on disk accessed through a buffered stdio stream.
+// the stream is opened on the descriptor of the file, so growth, truncation and syncing work on the
+// descriptor like for the file backend, after the stream buffer has been flushed
+
+static RC openStdioFile (SM_FileInfo *file_info, char *fileName, int *totalPages)
+{
+    RC rc = openDiskFile(file_info, fileName, totalPages);
+    if (rc != RC_OK || file_info->extents != NULL)
+        return rc;      // a compressed file is used through its extent map, without a stream
+
+    file_info->stream = fdopen(file_info->fd, "r+b");
+    if (file_info->stream == NULL)
+    {
+        closeDiskFile(file_info);
+        return RC_FILE_NOT_FOUND;
+    }
+    return RC_OK;
+}
+
+static void closeStdioFile (SM_FileInfo *file_info)
+{
+    // fclose also closes the descriptor
+    fclose(file_info->stream);
+    file_info->stream = NULL;
+    file_info->fd = -1;
+    closeDiskFile(file_info);
+}
+
+// seek to the first page and read or write the pages one after another. the stream is locked
+// for the whole range, so threads sharing the handle do not move each other's file position
+static RC transferStdioFile (SM_FileInfo *file_info, int startPage, int numPages, SM_PageHandle *pages, int isWrite)
+{
+    FILE *stream = file_info->stream;
+    RC rc = RC_OK;
+
+    // the library calls are counted in place of the system calls the stream makes
+    flockfile(stream);
+    unsigned long long start = monotonicNs();
+    if (fseeko(stream, pageOffset(file_info, startPage), SEEK_SET) != 0)
+        rc = isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+    countSyscall(start);
+
+    for (int i = 0; i < numPages && rc == RC_OK; i++)
+    {
+        start = monotonicNs();
+        size_t n = isWrite ? fwrite(pages[i], 1, file_info->pageSize, stream)
+                           : fread(pages[i], 1, file_info->pageSize, stream);
+        countSyscall(start);
+        if (isWrite)
+            threadIO.bytesWritten += n;
+        else
+            threadIO.bytesRead += n;
+        if (n != (size_t)file_info->pageSize)
+            rc = isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+    }
+    funlockfile(stream);
+    return rc;
+}
+
+static RC growStdioFile (SM_FileInfo *file_info, int oldPages, int numPages)
+{
+    if (fflush(file_info->stream) != 0)
+        return RC_WRITE_FAILED;
+    return growDiskFile(file_info, oldPages, numPages);
+}
+
+static RC shrinkStdioFile (SM_FileInfo *file_info, int numPages)
+{
+    if (fflush(file_info->stream) != 0)
+        return RC_WRITE_FAILED;
+    return shrinkDiskFile(file_info, numPages);
+}
+
+// fflush writes what the stream holds for the file and drops what it has read ahead, which may cover the pages
+static RC discardStdioPages (SM_FileInfo *file_info, int startPage, int numPages)
+{
+    if (fflush(file_info->stream) != 0)
+        return RC_WRITE_FAILED;
+    return discardDiskPages(file_info, startPage, numPages);
+}
+
+static int syncStdioFile (SM_FileInfo *file_info)
+{
+    if (fflush(file_info->stream) != 0)
+        return -1;
+    return syncDiskFile(file_info);
+}
+
+
+// SM_BACKEND_MEMORY: page files that only exist in the memory of the process.
+// files are found by name in a process wide list. a file destroyed while it is still open
+// disappears from the list at once and is freed by its last close, like an unlinked file on disk
+
+typedef struct SM_MemFile {
+    char *name;
+    int pageSize;
+    int numPages;
+    int capacity;           // length of pages[]
+    SM_PageHandle *pages;   // one aligned buffer per page, so page pointers stay valid while the file grows
+    pthread_rwlock_t lock;  // shared for page transfers, exclusive for changing the number of pages
+    int openCount;          // handles open on the file
+    int destroyed;          // no longer in the list, freed by the last close
+    uint64_t *freeMap;      // free page bitmap of the file (see SM_FileInfo)
+    int freeMapWords;
+    struct SM_MemFile *next;
+} SM_MemFile;
+
+static SM_MemFile *memFiles = NULL;
+static pthread_mutex_t memFilesLock = PTHREAD_MUTEX_INITIALIZER;    // protects memFiles and openCount/destroyed
+
+static void freeMemFile (SM_MemFile *mem)
+{
+    for (int i = 0; i < mem->numPages; i++)
+        freeAlignedPage(mem->pages[i]);
+    free(mem->pages);
+    free(mem->freeMap);
+    free(mem->name);
+    pthread_rwlock_destroy(&mem->lock);
+    free(mem);
+}
+
+// find the file called fileName (memFilesLock held)
+static SM_MemFile *findMemFile (const char *fileName)
+{
+    for (SM_MemFile *mem = memFiles; mem != NULL; mem = mem->next)
+    {
+        if (strcmp(mem->name, fileName) == 0)
+            return mem;
+    }
+    return NULL;
+}
+
+// take the file called fileName out of the list and free it unless it is still open (memFilesLock held).
+// returns 0 if there is no such file
+static int detachMemFile (const char *fileName)
+{
+    for (SM_MemFile **link = &memFiles; *link != NULL; link = &(*link)->next)
+    {
+        SM_MemFile *mem = *link;
+        if (strcmp(mem->name, fileName) != 0)
+            continue;
+
+        *link = mem->next;
+        if (mem->openCount == 0)
+            freeMemFile(mem);
+        else
+            mem->destroyed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// change the number of pages of the file, new pages are zero (write lock held or file not shared yet)
+static RC resizeMemFile (SM_MemFile *mem, int numPages)
+{
+    if (numPages > mem->capacity)
+    {
+        int capacity = (mem->capacity * 2 > numPages) ? mem->capacity * 2 : numPages;
+        SM_PageHandle *pages = (SM_PageHandle *)realloc(mem->pages, sizeof(SM_PageHandle) * capacity);
+        if (pages == NULL)
+            return RC_WRITE_FAILED;
+        mem->pages = pages;
+        mem->capacity = capacity;
+    }
+
+    while (mem->numPages > numPages)
+        freeAlignedPage(mem->pages[--mem->numPages]);
+    while (mem->numPages < numPages)
+    {
+        SM_PageHandle page = allocAlignedBuffer(mem->pageSize);
+        if (page == NULL)
+            return RC_WRITE_FAILED;
+        mem->pages[mem->numPages++] = page;
+    }
+    return RC_OK;
+}
+
+static RC createMemFile (char *fileName, int pageSize)
+{
+    SM_MemFile *mem = (SM_MemFile *)calloc(1, sizeof(SM_MemFile));
+    if (mem == NULL)
+        return RC_WRITE_FAILED;
+    mem->name = strdup(fileName);
+    mem->pageSize = pageSize;
+    pthread_rwlock_init(&mem->lock, NULL);
+    if (mem->name == NULL || resizeMemFile(mem, 1) != RC_OK)
+    {
+        freeMemFile(mem);
+        return RC_WRITE_FAILED;
+    }
+
+    // like creating a file on disk, an existing file with the same name is replaced
+    pthread_mutex_lock(&memFilesLock);
+    detachMemFile(fileName);
+    mem->next = memFiles;
+    memFiles = mem;
+    pthread_mutex_unlock(&memFilesLock);
+    return RC_OK;
+}
+
+static RC destroyMemFile (char *fileName)
+{
+    pthread_mutex_lock(&memFilesLock);
+    int found = detachMemFile(fileName);
+    pthread_mutex_unlock(&memFilesLock);
+    return found ? RC_OK : RC_FILE_NOT_FOUND;
+}
+
+static RC openMemFile (SM_FileInfo *file_info, char *fileName, int *totalPages)
+{
+    pthread_mutex_lock(&memFilesLock);
+    SM_MemFile *mem = findMemFile(fileName);
+    if (mem == NULL)
+    {
+        pthread_mutex_unlock(&memFilesLock);
+        return RC_FILE_NOT_FOUND;
     }
+    mem->openCount++;
+    pthread_mutex_unlock(&memFilesLock);
 
-    // if everything succeeds, cleanup the allocated memory and return ok
-    free(empty_page);
-    fclose(page_file);
+    pthread_rwlock_rdlock(&mem->lock);
+    *totalPages = mem->numPages;
+    pthread_rwlock_unlock(&mem->lock);
 
+    file_info->memFile = mem;
+    file_info->pageSize = mem->pageSize;
+    file_info->headerSize = 0;
+    file_info->allocatedPages = *totalPages;
     return RC_OK;
 }
 
+static void closeMemFile (SM_FileInfo *file_info)
+{
+    SM_MemFile *mem = file_info->memFile;
 
-// open an existing pagefile
-extern RC openPageFile (char *fileName, SM_FileHandle *fHandle)
+    pthread_mutex_lock(&memFilesLock);
+    if (--mem->openCount == 0 && mem->destroyed)
+        freeMemFile(mem);
+    pthread_mutex_unlock(&memFilesLock);
+    file_info->memFile = NULL;
+}
+
+// another handle on the same file may have truncated it, so the range is checked against the store
+static RC transferMemFile (SM_FileInfo *file_info, int startPage, int numPages, SM_PageHandle *pages, int isWrite)
 {
-    //open the file in read binary plus mode. "rb+" allows reading an existing binary file.
-     FILE *page_file = fopen(fileName, "rb+");
+    SM_MemFile *mem = file_info->memFile;
+    RC rc = RC_OK;
 
-     if(page_file == NULL)
+    pthread_rwlock_rdlock(&mem->lock);
+    if (startPage + numPages > mem->numPages)
+        rc = isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+    for (int i = 0; i < numPages && rc == RC_OK; i++)
     {
-        return RC_FILE_NOT_FOUND;   //if file opening is failed
+        if (isWrite)
+            memcpy(mem->pages[startPage + i], pages[i], mem->pageSize);
+        else
+            memcpy(pages[i], mem->pages[startPage + i], mem->pageSize);
     }
+    pthread_rwlock_unlock(&mem->lock);
+    return rc;
+}
 
-    // to calculate file size we followed below steps:
-    fseek(page_file, 0, SEEK_END);  //use fseek to move to the end of file
-    long file_end_position = ftell(page_file);  //ftell gives the current position (in this case, its the end position)
-    fseek(page_file, 0, SEEK_SET);   //move back to initial position of file
-
-    // total number of pages that are stored on file can calculated by didviding file end position by page size
-    int total_no_of_pages = file_end_position/PAGE_SIZE;
-
-    // store the filename in filehandle
-    fHandle->fileName = fileName;
+static RC growMemFile (SM_FileInfo *file_info, int oldPages, int numPages)
+{
+    (void)oldPages;
+    SM_MemFile *mem = file_info->memFile;
+    RC rc = RC_OK;
+
+    // another handle may have grown the file already
+    pthread_rwlock_wrlock(&mem->lock);
+    if (numPages > mem->numPages)
+        rc = resizeMemFile(mem, numPages);
+    pthread_rwlock_unlock(&mem->lock);
+    return rc;
+}
 
-    //store the total number of pages in file to filehandle
-    fHandle->totalNumPages = total_no_of_pages;
+static RC shrinkMemFile (SM_FileInfo *file_info, int numPages)
+{
+    SM_MemFile *mem = file_info->memFile;
 
-    //set the current position to first page
-    fHandle->curPagePos = 0;
+    pthread_rwlock_wrlock(&mem->lock);
+    RC rc = resizeMemFile(mem, numPages);
+    pthread_rwlock_unlock(&mem->lock);
+    return rc;
+}
 
-    //store the any additional information about file that might be needed
-    fHandle->mgmtInfo = page_file;
+// page buffers are whole, aligned memory pages: MADV_DONTNEED gives the memory back and leaves zeros
+static RC discardMemPages (SM_FileInfo *file_info, int startPage, int numPages)
+{
+    SM_MemFile *mem = file_info->memFile;
+    long systemPage = sysconf(_SC_PAGESIZE);
+    RC rc = RC_OK;
+
+    pthread_rwlock_rdlock(&mem->lock);
+    if (startPage + numPages > mem->numPages)
+        rc = RC_WRITE_FAILED;
+    for (int i = 0; i < numPages && rc == RC_OK; i++)
+    {
+        char *page = mem->pages[startPage + i];
+        if (systemPage <= 0 || (uintptr_t)page % systemPage != 0 || mem->pageSize % systemPage != 0
+            || madvise(page, mem->pageSize, MADV_DONTNEED) != 0)
+            memset(page, 0, mem->pageSize);
+    }
+    pthread_rwlock_unlock(&mem->lock);
+    return rc;
+}
 
+// the pages are in memory already
+static RC adviseMemPages (SM_FileInfo *file_info, int advice, int startPage, int numPages)
+{
+    (void)file_info; (void)advice; (void)startPage; (void)numPages;
     return RC_OK;
 }
 
+// there is nothing to make durable
+static int syncMemFile (SM_FileInfo *file_info)
+{
+    (void)file_info;
+    return 0;
+}
 
-//close an open page file
-extern RC closePageFile (SM_FileHandle *fHandle)
+// the bitmap of a memory file is kept with its pages
+static RC loadMemFreeMap (SM_FileInfo *file_info, char *fileName)
 {
-    // check if filehandle is valid to prevent operations on uninitialized handle
-    if(fHandle == NULL)
+    (void)fileName;
+    SM_MemFile *mem = file_info->memFile;
+    RC rc = RC_OK;
+
+    pthread_rwlock_rdlock(&mem->lock);
+    if (mem->freeMapWords > 0)
     {
-        //file handle = null indicates that file handle is not valid
-        return RC_FILE_HANDLE_NOT_INIT;
+        file_info->freeMap = (uint64_t *)malloc(sizeof(uint64_t) * mem->freeMapWords);
+        if (file_info->freeMap == NULL)
+            rc = RC_FILE_HANDLE_NOT_INIT;
+        else
+        {
+            memcpy(file_info->freeMap, mem->freeMap, sizeof(uint64_t) * mem->freeMapWords);
+            file_info->freeMapWords = mem->freeMapWords;
+        }
     }
+    pthread_rwlock_unlock(&mem->lock);
+    return rc;
+}
 
-    // if file handle is initilaized
-    // cast the file handle mgmtinfo(additional file info) to a file pointer
-    FILE *page_file = (FILE *)fHandle->mgmtInfo;
+static RC storeMemFreeMap (SM_FileInfo *file_info, int firstWord, int numWords)
+{
+    SM_MemFile *mem = file_info->memFile;
+    RC rc = RC_OK;
 
-    // if the file pointer is not null then close the file
-    if (page_file != NULL) {
-        fclose(page_file);
+    pthread_rwlock_wrlock(&mem->lock);
+    if (firstWord + numWords > mem->freeMapWords)
+    {
+        uint64_t *map = (uint64_t *)realloc(mem->freeMap, sizeof(uint64_t) * (firstWord + numWords));
+        if (map == NULL)
+            rc = RC_WRITE_FAILED;
+        else
+        {
+            memset(&map[mem->freeMapWords], 0, sizeof(uint64_t) * (firstWord + numWords - mem->freeMapWords));
+            mem->freeMap = map;
+            mem->freeMapWords = firstWord + numWords;
+        }
     }
+    if (rc == RC_OK)
+        memcpy(&mem->freeMap[firstWord], &file_info->freeMap[firstWord], sizeof(uint64_t) * numWords);
+    pthread_rwlock_unlock(&mem->lock);
+    return rc;
+}
 
-    // after closing the file, set all fields of file handle to initial values
-    // to ensure this file handle cannot be used without intializing it again
-    fHandle->fileName = NULL;
-    fHandle->totalNumPages = 0;
-    fHandle->curPagePos = 0;
-    fHandle->mgmtInfo = NULL;
+static char *memPagePointer (SM_FileInfo *file_info, int pageNum)
+{
+    SM_MemFile *mem = file_info->memFile;
 
-    //return ok , if all the operations are successful
-    return RC_OK;
+    pthread_rwlock_rdlock(&mem->lock);
+    char *page = (pageNum < mem->numPages) ? mem->pages[pageNum] : NULL;
+    pthread_rwlock_unlock(&mem->lock);
+    return page;
 }
 
 
-// destroy/delete a page file
-extern RC destroyPageFile (char *fileName)
+// compressed page files (createCompressedPageFile). opened by any of the disk backends, then used through
+// this one: pages are compressed into extents found through the page to extent map (see SM_ExtentMap)
+
+// read page pageNum into memPage; buf has room for a compressed page
+static RC readCompressedPage (SM_FileInfo *file_info, int pageNum, char *memPage, char *buf)
 {
-    //check if filename is valid. If not, return error 
-    if(fileName == NULL)
-        return RC_FILE_NOT_FOUND;
+    SM_ExtentMap *map = file_info->extents;
 
-    // if filename exists, then try to remove the file
-    if (remove(fileName) != 0)     // remove() returns 0 if successful, returns non zero if failed
+    pthread_mutex_lock(&map->lock);
+    SM_PageExtent extent = map->pages[pageNum];
+    pthread_mutex_unlock(&map->lock);
+
+    if (extent.length == 0)
     {
-        // If remove fails, return an error
-        return RC_FILE_NOT_FOUND;
+        memset(memPage, 0, file_info->pageSize);
+        return RC_OK;
     }
+    if (extent.length == (uint32_t)file_info->pageSize)
+        return (preadFully(file_info->fd, memPage, extent.length, extent.offset) == (ssize_t)extent.length)
+               ? RC_OK : RC_READ_NON_EXISTING_PAGE;
 
-    // if remove operation is successful , return ok
+    if (preadFully(file_info->fd, buf, extent.length, extent.offset) != (ssize_t)extent.length)
+        return RC_READ_NON_EXISTING_PAGE;
+    if (lzDecompress(buf, extent.length, memPage, file_info->pageSize) != file_info->pageSize)
+        return RC_INVALID_PAGE_FILE;
     return RC_OK;
 }
 
-
-// read the block at pageNum position from a file and store its content
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+// compress memPage into buf and write it as page pageNum. the page stays in its extent if it still fits
+// and does not leave more than half of it unused; otherwise it moves to a new extent
+static RC writeCompressedPage (SM_FileInfo *file_info, int pageNum, const char *memPage, char *buf)
 {
-    // check if filehandle is valid to prevent operations on uninitialized handle
-    if(fHandle == NULL)
+    SM_ExtentMap *map = file_info->extents;
+    int length = 0;
+    const char *data = buf;
+
+    // a page of zeros needs no extent, a page that does not save at least one allocation unit is stored as it is
+    if (!isZeroPage(memPage, file_info->pageSize))
     {
-        //file handle = null indicates that file handle is not valid
-        return RC_FILE_HANDLE_NOT_INIT;
+        length = lzCompress(memPage, file_info->pageSize, buf, file_info->pageSize - SM_EXTENT_ALIGN);
+        if (length == 0)
+        {
+            length = file_info->pageSize;
+            data = memPage;
+        }
     }
 
-    //retrieve file pointer from filehandle's management info
-    FILE *page_file = (FILE *)fHandle->mgmtInfo;
-    
-    //check if the file pointer is valid
-    if(page_file == NULL)
+    pthread_mutex_lock(&map->lock);
+    SM_PageExtent *extent = &map->pages[pageNum];
+    off_t size = extentSize(length);
+    if (size == 0 || size > extent->capacity || size * 2 <= extent->capacity)
     {
-        return RC_FILE_NOT_FOUND;   // if not valid
+        retireExtent(map, extent->offset, extent->capacity);
+        extent->offset = (size > 0) ? allocExtent(map, size) : 0;
+        extent->capacity = size;
     }
+    extent->length = length;
+    off_t offset = extent->offset;
+    map->dirty = 1;
+    pthread_mutex_unlock(&map->lock);
 
-    //check if pageNum is valid. It should be >= 0 and less than filehandle's total number of pages
-    if(pageNum < 0 || pageNum >= fHandle->totalNumPages)
-        return RC_READ_NON_EXISTING_PAGE;
+    if (length > 0 && pwriteFully(file_info->fd, data, length, offset) != 0)
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+static RC transferCompressedFile (SM_FileInfo *file_info, int startPage, int numPages, SM_PageHandle *pages, int isWrite)
+{
+    RC rc = RC_OK;
+    char *buf = (char *)malloc(file_info->pageSize);
+    if (buf == NULL)
+        return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
 
-    //move the filepointer to the start position of requested page (requested page position = pageNum * pagesize)
-    if(fseek(page_file, pageNum * PAGE_SIZE, SEEK_SET) != 0)
-    {   
-        return RC_READ_NON_EXISTING_PAGE;   //if fseek operation failed
+    for (int i = 0; i < numPages && rc == RC_OK; i++)
+    {
+        if (isWrite)
+            rc = writeCompressedPage(file_info, startPage + i, pages[i], buf);
+        else
+            rc = readCompressedPage(file_info, startPage + i, pages[i], buf);
     }
+    free(buf);
+    return rc;
+}
 
-    //read page content and store it into memeory pointed my memPage
-    size_t read_bytes_size = fread(memPage, sizeof(char), PAGE_SIZE, page_file);
+// new pages are pages of zeros, they only need map entries
+static RC growCompressedFile (SM_FileInfo *file_info, int oldPages, int numPages)
+{
+    (void)oldPages;
+    SM_ExtentMap *map = file_info->extents;
+    RC rc = RC_OK;
 
-    //check if correct number of bytes are read (if read_bytes size is equal to page size)
-    if(read_bytes_size != PAGE_SIZE)
+    pthread_mutex_lock(&map->lock);
+    if (numPages > map->capacity)
     {
-        return RC_READ_NON_EXISTING_PAGE;
+        int capacity = (map->capacity * 2 > numPages) ? map->capacity * 2 : numPages;
+        SM_PageExtent *pages = (SM_PageExtent *)realloc(map->pages, sizeof(SM_PageExtent) * capacity);
+        if (pages == NULL)
+            rc = RC_WRITE_FAILED;
+        else
+        {
+            map->pages = pages;
+            map->capacity = capacity;
+        }
+    }
+    if (rc == RC_OK && numPages > map->numPages)
+    {
+        memset(&map->pages[map->numPages], 0, sizeof(SM_PageExtent) * (numPages - map->numPages));
+        map->numPages = numPages;
+        map->dirty = 1;
     }
+    pthread_mutex_unlock(&map->lock);
+    return rc;
+}
 
-    //update current page position in the file handle after successful read operation
-    fHandle->curPagePos = pageNum;
+static RC shrinkCompressedFile (SM_FileInfo *file_info, int numPages)
+{
+    SM_ExtentMap *map = file_info->extents;
+
+    pthread_mutex_lock(&map->lock);
+    for (int i = numPages; i < map->numPages; i++)
+        retireExtent(map, map->pages[i].offset, map->pages[i].capacity);
+    map->numPages = numPages;
+    map->dirty = 1;
+    pthread_mutex_unlock(&map->lock);
     return RC_OK;
 }
 
+// a discarded page becomes a page of zeros, which has no extent and is read without any I/O
+static RC discardCompressedPages (SM_FileInfo *file_info, int startPage, int numPages)
+{
+    SM_ExtentMap *map = file_info->extents;
 
-//returns an int, which is current block page position
-extern int getBlockPos (SM_FileHandle *fHandle)
+    pthread_mutex_lock(&map->lock);
+    for (int i = startPage; i < startPage + numPages; i++)
+    {
+        retireExtent(map, map->pages[i].offset, map->pages[i].capacity);
+        map->pages[i] = (SM_PageExtent){ 0 };
+    }
+    map->dirty = 1;
+    pthread_mutex_unlock(&map->lock);
+    return RC_OK;
+}
+
+// the extents of a page range can lie anywhere in the file: an access pattern applies to the whole file,
+// WILLNEED/DONTNEED to the extents of the pages (adjacent extents in one call)
+static RC adviseCompressedPages (SM_FileInfo *file_info, int advice, int startPage, int numPages)
 {
-    // check if filehandle is valid to prevent operations on uninitialized handle
-    if(fHandle == NULL || fHandle->mgmtInfo == NULL)
+    SM_ExtentMap *map = file_info->extents;
+    if (advice != SM_ADVICE_WILLNEED && advice != SM_ADVICE_DONTNEED)
+        return (posix_fadvise(file_info->fd, 0, 0, fileAdvice(advice)) == 0) ? RC_OK : RC_FILE_HANDLE_NOT_INIT;
+
+    off_t start = 0, end = 0;
+    pthread_mutex_lock(&map->lock);
+    for (int i = startPage; i <= startPage + numPages; i++)
     {
-        //file handle = null indicates that file handle is not valid
-        return -1;
+        SM_PageExtent *extent = (i < startPage + numPages) ? &map->pages[i] : NULL;
+        if (extent != NULL && extent->length == 0)
+            continue;
+        if (extent != NULL && (off_t)extent->offset == end)
+        {
+            end += extent->capacity;
+            continue;
+        }
+        if (end > start)
+            posix_fadvise(file_info->fd, start, end - start, fileAdvice(advice));
+        if (extent != NULL)
+        {
+            start = extent->offset;
+            end = start + extent->capacity;
+        }
     }
+    pthread_mutex_unlock(&map->lock);
+    return RC_OK;
+}
 
-    return fHandle->curPagePos;
+static int syncCompressedFile (SM_FileInfo *file_info)
+{
+    if (file_info->fsmFd >= 0 && dataSync(file_info->fsmFd) != 0)
+        return -1;
+    return (writeExtentMap(file_info, 1) == RC_OK) ? 0 : -1;
 }
 
-// read the first page of file
-extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+// the map is written back without waiting for stable storage, like the pages themselves
+static void closeCompressedFile (SM_FileInfo *file_info)
 {
-    int firstPageNum = 0; //indicates first page
-    //pass this pageNum as input parameter to readBlock() function
-    return readBlock(firstPageNum, fHandle, memPage);
+    writeExtentMap(file_info, 0);
+    closeDiskFile(file_info);
 }
 
 
-//read the previous page of file handles curPagePos
-extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+static const SM_Backend fileBackend = {
+    .create = createDiskFile,
+    .destroy = destroyDiskFile,
+    .open = openDiskFile,
+    .close = closeDiskFile,
+    .transfer = transferBlockRange,
+    .grow = growDiskFile,
+    .shrink = shrinkDiskFile,
+    .discard = discardDiskPages,
+    .advise = adviseDiskPages,
+    .sync = syncDiskFile,
+    .pagePointer = NULL,
+    .loadFreeMap = loadDiskFreeMap,
+    .storeFreeMap = storeDiskFreeMap
+};
+
+static const SM_Backend stdioBackend = {
+    .create = createDiskFile,
+    .destroy = destroyDiskFile,
+    .open = openStdioFile,
+    .close = closeStdioFile,
+    .transfer = transferStdioFile,
+    .grow = growStdioFile,
+    .shrink = shrinkStdioFile,
+    .discard = discardStdioPages,
+    .advise = adviseDiskPages,
+    .sync = syncStdioFile,
+    .pagePointer = NULL,
+    .loadFreeMap = loadDiskFreeMap,
+    .storeFreeMap = storeDiskFreeMap
+};
+
+static const SM_Backend mmapBackend = {
+    .create = createDiskFile,
+    .destroy = destroyDiskFile,
+    .open = openMappedFile,
+    .close = closeMappedFile,
+    .transfer = transferMappedFile,
+    .grow = growMappedFile,
+    .shrink = shrinkMappedFile,
+    .discard = discardMappedPages,
+    .advise = adviseMappedPages,
+    .sync = syncMappedFile,
+    .pagePointer = mappedPagePointer,
+    .loadFreeMap = loadDiskFreeMap,
+    .storeFreeMap = storeDiskFreeMap
+};
+
+static const SM_Backend memoryBackend = {
+    .create = createMemFile,
+    .destroy = destroyMemFile,
+    .open = openMemFile,
+    .close = closeMemFile,
+    .transfer = transferMemFile,
+    .grow = growMemFile,
+    .shrink = shrinkMemFile,
+    .discard = discardMemPages,
+    .advise = adviseMemPages,
+    .sync = syncMemFile,
+    .pagePointer = memPagePointer,
+    .loadFreeMap = loadMemFreeMap,
+    .storeFreeMap = storeMemFreeMap
+};
+
+static const SM_Backend compressedBackend = {
+    .create = createCompressedDiskFile,
+    .destroy = destroyDiskFile,
+    .open = openDiskFile,
+    .close = closeCompressedFile,
+    .transfer = transferCompressedFile,
+    .grow = growCompressedFile,
+    .shrink = shrinkCompressedFile,
+    .discard = discardCompressedPages,
+    .advise = adviseCompressedPages,
+    .sync = syncCompressedFile,
+    .pagePointer = NULL,
+    .loadFreeMap = loadDiskFreeMap,
+    .storeFreeMap = storeDiskFreeMap
+};
+
+// choose the backend (SM_BACKEND_*) for page files created, opened or destroyed from now on.
+// files that are open keep the backend they were opened with. not meant to be called while other threads open files
+extern RC setStorageBackend (int backend)
 {
-    // check if filehandle is valid to prevent operations on uninitialized handle
-    if(fHandle == NULL)
+    switch (backend)
     {
-        //file handle = null indicates that file handle is not valid
-        return RC_FILE_HANDLE_NOT_INIT;
+        case SM_BACKEND_FILE:
+            defaultBackend = &fileBackend;
+            return RC_OK;
+        case SM_BACKEND_STDIO:
+            defaultBackend = &stdioBackend;
+            return RC_OK;
+        case SM_BACKEND_MMAP:
+            defaultBackend = &mmapBackend;
+            return RC_OK;
+        case SM_BACKEND_MEMORY:
+            defaultBackend = &memoryBackend;
+            return RC_OK;
+        default:
+            return RC_WRITE_FAILED;
     }
-    int prevPageNum = fHandle->curPagePos - 1;
+}
 
-    //pass this pageNum as input parameter to readBlock() function
-    return readBlock(prevPageNum, fHandle, memPage);
+// the backend chosen with setStorageBackend (SM_BACKEND_FILE by default)
+extern int getStorageBackend (void)
+{
+    if (defaultBackend == &stdioBackend)
+        return SM_BACKEND_STDIO;
+    if (defaultBackend == &mmapBackend)
+        return SM_BACKEND_MMAP;
+    if (defaultBackend == &memoryBackend)
+        return SM_BACKEND_MEMORY;
+    return SM_BACKEND_FILE;
 }
 
 
-//read the current page 
-extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+/************************************************************
+ *                 asynchronous block I/O                   *
+ ************************************************************/
+
+// one submitted request. a slot stays in use from submitRead/submitWrite until its completion
+// has been handed to the caller by pollCompletions
+typedef struct SM_AsyncRequest {
+    SM_FileInfo *file_info;     // file the request targets
+    int pageNum;
+    int isWrite;
+    SM_PageHandle memPage;
+    void *userData;
+    RC rc;                      // result, valid once the request is completed
+    struct iovec iov;           // single buffer descriptor for IORING_OP_READV/WRITEV
+} SM_AsyncRequest;
+
+// bookkeeping behind SM_AsyncEngine.mgmtInfo
+typedef struct SM_AsyncInfo {
+    pthread_mutex_t lock;       // protects everything below
+    pthread_cond_t completed;   // signalled when a request is moved to the ready queue
+    int queueDepth;             // number of request slots
+    SM_AsyncRequest *requests;  // queueDepth request slots
+    int *freeSlots;             // stack of unused slot indices
+    int numFree;
+    int *ready;                 // ring of completed slot indices, not yet returned by pollCompletions
+    int readyHead;
+    int readyCount;
+    int inFlight;               // requests handed to the backend and not completed yet
+
+#ifdef SM_HAVE_IO_URING
+    int ringFd;                 // io_uring instance
+    void *sqRing;
+    void *cqRing;
+    size_t sqRingSize;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+#endif
+
+    pthread_t *workers;         // worker threads of the SM_ASYNC_THREADS backend
+    int numWorkers;
+    pthread_cond_t hasWork;     // signalled when a request is queued for the workers
+    int *pending;               // ring of slot indices waiting for a worker
+    int pendingHead;
+    int pendingCount;
+    int stopping;               // set by shutdownAsyncEngine to stop the workers
+} SM_AsyncInfo;
+
+
+// mark a request as completed with the given result (lock held)
+static void completeRequest (SM_AsyncInfo *info, int slot, RC rc)
 {
-    // check if filehandle is valid to prevent operations on uninitialized handle
-    if(fHandle == NULL)
-    {
-        //file handle = null indicates that file handle is not valid
-        return RC_FILE_HANDLE_NOT_INIT;
-    }
-    int currPageNum = fHandle->curPagePos;
+    info->requests[slot].rc = rc;
+    info->ready[(info->readyHead + info->readyCount) % info->queueDepth] = slot;
+    info->readyCount++;
+    info->inFlight--;
+    pthread_cond_broadcast(&info->completed);
+}
 
-    //pass this pageNum as input parameter to readBlock() function
-    return readBlock(currPageNum, fHandle, memPage);
+// perform a request synchronously in the calling thread
+static RC performRequest (SM_AsyncRequest *request)
+{
+    SM_FileInfo *file_info = request->file_info;
+    return file_info->backend->transfer(file_info, request->pageNum, 1, &request->memPage, request->isWrite);
 }
 
 
-//read the next page of file handles curPagePos
-extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-{
-    // check if filehandle is valid to prevent operations on uninitialized handle
-    if(fHandle == NULL)
-    {
-        //file handle = null indicates that file handle is not valid
-        return RC_FILE_HANDLE_NOT_INIT;
-    }
-    int currPageNum = fHandle->curPagePos + 1;
+#ifdef SM_HAVE_IO_URING
 
-    //pass this pageNum as input parameter to readBlock() function
-    return readBlock(currPageNum, fHandle, memPage);
+static int ioUringSetup (unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
 }
 
-
-//read the last page of file handles curPagePos
-extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+static int ioUringEnter (int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags)
 {
-    // check if filehandle is valid to prevent operations on uninitialized handle
-    if(fHandle == NULL)
-    {
-        //file handle = null indicates that file handle is not valid
-        return RC_FILE_HANDLE_NOT_INIT;
-    }
-    int lastPageNum = fHandle->totalNumPages - 1;
-    //pass this pageNum as input parameter to readBlock() function
-    return readBlock(lastPageNum, fHandle, memPage);
+    return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
 }
 
-// write a page to disk
-extern RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) 
+// create the io_uring instance and map its submission and completion rings
+static RC initIoUring (SM_AsyncInfo *info, int queueDepth)
 {
-    // Check if file handle is valid
-    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL) 
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    info->ringFd = ioUringSetup(queueDepth, &params);
+    if (info->ringFd < 0)
+        return RC_ASYNC_INIT_FAILED;    // kernel without io_uring or io_uring disabled
+
+    info->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    info->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
     {
-        return RC_FILE_NOT_FOUND;   //if file handle is invalid
+        if (info->cqRingSize > info->sqRingSize)
+            info->sqRingSize = info->cqRingSize;
+        info->cqRingSize = info->sqRingSize;
     }
 
-    // Check if the given pageNum is valid
-    if (pageNum < 0 || pageNum >= fHandle->totalNumPages) 
+    info->sqRing = mmap(NULL, info->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        info->ringFd, IORING_OFF_SQ_RING);
+    if (info->sqRing == MAP_FAILED)
     {
-        return RC_WRITE_FAILED;    // Writing to a non-existing page is considered a failure
+        close(info->ringFd);
+        return RC_ASYNC_INIT_FAILED;
     }
 
-    //retrieve file pointer from filehandle's management info
-    FILE *page_file = (FILE *)fHandle->mgmtInfo;
-
-    // check if the file is opened
-    if (page_file == NULL)
-        return RC_FILE_NOT_FOUND;
-    
-    //move the filepointer to the start position of requested page (requested page position = pageNum * pagesize)
-    if(fseek(page_file, pageNum * PAGE_SIZE, SEEK_SET) != 0)
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        info->cqRing = info->sqRing;
+    else
     {
-        return RC_READ_NON_EXISTING_PAGE;   //if fseek operation failed
+        info->cqRing = mmap(NULL, info->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            info->ringFd, IORING_OFF_CQ_RING);
+        if (info->cqRing == MAP_FAILED)
+        {
+            munmap(info->sqRing, info->sqRingSize);
+            close(info->ringFd);
+            return RC_ASYNC_INIT_FAILED;
+        }
     }
 
-    // Write the block from the memory buffer to the file
-    size_t write_bytes_size = fwrite(memPage, sizeof(char), PAGE_SIZE, page_file);
-
-    //check if correct number of bytes are written (if write_bytes_size size is equal to page size)
-    if (write_bytes_size != PAGE_SIZE) 
+    info->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    info->sqes = mmap(NULL, info->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      info->ringFd, IORING_OFF_SQES);
+    if (info->sqes == MAP_FAILED)
     {
-        fclose(page_file);
-        return RC_WRITE_FAILED;
+        if (info->cqRing != info->sqRing)
+            munmap(info->cqRing, info->cqRingSize);
+        munmap(info->sqRing, info->sqRingSize);
+        close(info->ringFd);
+        return RC_ASYNC_INIT_FAILED;
     }
 
-    // Update the current page position in file handle
-    fHandle->curPagePos = pageNum;
-    // Return success
+    char *sq = (char *)info->sqRing;
+    char *cq = (char *)info->cqRing;
+    info->sqHead = (unsigned *)(sq + params.sq_off.head);
+    info->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    info->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    info->sqArray = (unsigned *)(sq + params.sq_off.array);
+    info->cqHead = (unsigned *)(cq + params.cq_off.head);
+    info->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    info->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    info->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
     return RC_OK;
 }
 
+static void shutdownIoUring (SM_AsyncInfo *info)
+{
+    munmap(info->sqes, info->sqesSize);
+    if (info->cqRing != info->sqRing)
+        munmap(info->cqRing, info->cqRingSize);
+    munmap(info->sqRing, info->sqRingSize);
+    close(info->ringFd);
+}
 
-//write the current page
-extern RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) 
+// queue one request on the submission ring and hand it to the kernel (lock held).
+// the number of requests never exceeds the ring size, so there is always a free entry.
+// if the kernel does not take the entry (EAGAIN, EBUSY, ...) it is taken off the ring again, so a later
+// submission cannot hand it in after the request was completed as failed
+static RC submitIoUring (SM_AsyncInfo *info, int slot)
 {
-    // Check if file handle is valid
-    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL)
-        return RC_FILE_NOT_FOUND;
+    SM_AsyncRequest *request = &info->requests[slot];
+    request->iov.iov_base = request->memPage;
+    request->iov.iov_len = request->file_info->pageSize;
+
+    off_t offset;
+    int fd = pageLocation(request->file_info, request->pageNum, &offset);
+    if (fd < 0)
+        return request->isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+    unsigned tail = *info->sqTail;
+    unsigned index = tail & *info->sqMask;
+    struct io_uring_sqe *sqe = &info->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = request->isWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)&request->iov;
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = slot;
+    info->sqArray[index] = index;
+
+    // publish the entry before the new tail becomes visible to the kernel
+    __atomic_store_n(info->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted;
+    do {
+        submitted = ioUringEnter(info->ringFd, 1, 0, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted == 1)
+        return RC_OK;
 
-    // Get the current page position
-    int curPage = fHandle->curPagePos;
+    // the kernel only consumes entries inside io_uring_enter, and submissions hold the lock:
+    // the head either passed the entry (it is in flight after all) or still points at it
+    if (__atomic_load_n(info->sqHead, __ATOMIC_ACQUIRE) != tail)
+        return RC_OK;
+    __atomic_store_n(info->sqTail, tail, __ATOMIC_RELEASE);
+    return request->isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+}
 
-    // Call the writeBlock function to write the current block
-    return writeBlock(curPage, fHandle, memPage);
+// move all finished requests from the completion ring to the ready queue (lock held)
+static void reapIoUring (SM_AsyncInfo *info)
+{
+    unsigned head = *info->cqHead;
+    unsigned tail = __atomic_load_n(info->cqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail)
+    {
+        struct io_uring_cqe *cqe = &info->cqes[head & *info->cqMask];
+        int slot = (int)cqe->user_data;
+        RC rc = RC_OK;
+        if (cqe->res != info->requests[slot].file_info->pageSize)
+            rc = info->requests[slot].isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        completeRequest(info, slot, rc);
+        head++;
+    }
+
+    __atomic_store_n(info->cqHead, head, __ATOMIC_RELEASE);
 }
 
+#endif
 
-//append a new last page that is filled with zero bytes and increase total number of pages by one.
-extern RC appendEmptyBlock(SM_FileHandle *fHandle) 
+
+// worker thread of the SM_ASYNC_THREADS backend: take queued requests and perform them with pread/pwrite
+static void *asyncWorker (void *arg)
 {
+    SM_AsyncInfo *info = (SM_AsyncInfo *)arg;
 
-    // Check if file handle is valid
-    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL)
-        return RC_FILE_NOT_FOUND;
+    pthread_mutex_lock(&info->lock);
+    while (1)
+    {
+        while (info->pendingCount == 0 && !info->stopping)
+            pthread_cond_wait(&info->hasWork, &info->lock);
+        if (info->pendingCount == 0)
+            break;      // stopping and nothing left to do
 
-    //retrieve file pointer from filehandle's management info
-    FILE *page_file = (FILE *)fHandle->mgmtInfo;
-    if (page_file == NULL)
-        return RC_FILE_NOT_FOUND;
+        int slot = info->pending[info->pendingHead];
+        info->pendingHead = (info->pendingHead + 1) % info->queueDepth;
+        info->pendingCount--;
+
+        pthread_mutex_unlock(&info->lock);
+        RC rc = performRequest(&info->requests[slot]);
+        pthread_mutex_lock(&info->lock);
 
-    // create an empty page by allocating memory for one page (initializes memory with zero('\0') bytes)
-    SM_PageHandle emptyBlock = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
+        completeRequest(info, slot, rc);
+    }
+    pthread_mutex_unlock(&info->lock);
+    return NULL;
+}
 
-    if(emptyBlock == NULL)
+// start numWorkers worker threads
+static RC initAsyncWorkers (SM_AsyncInfo *info, int queueDepth)
+{
+    info->numWorkers = (queueDepth < SM_ASYNC_MAX_WORKERS) ? queueDepth : SM_ASYNC_MAX_WORKERS;
+    info->workers = (pthread_t *)malloc(sizeof(pthread_t) * info->numWorkers);
+    info->pending = (int *)malloc(sizeof(int) * queueDepth);
+    if (info->workers == NULL || info->pending == NULL)
+        return RC_ASYNC_INIT_FAILED;
+
+    pthread_cond_init(&info->hasWork, NULL);
+    info->pendingHead = 0;
+    info->pendingCount = 0;
+    info->stopping = 0;
+
+    for (int i = 0; i < info->numWorkers; i++)
     {
-        // if failed to allocate memory
-        fclose(page_file);      // close the file to prevent resource leaks
-        return RC_WRITE_FAILED; 
+        if (pthread_create(&info->workers[i], NULL, asyncWorker, info) != 0)
+        {
+            // stop the workers that did start
+            pthread_mutex_lock(&info->lock);
+            info->stopping = 1;
+            pthread_cond_broadcast(&info->hasWork);
+            pthread_mutex_unlock(&info->lock);
+            for (int j = 0; j < i; j++)
+                pthread_join(info->workers[j], NULL);
+            pthread_cond_destroy(&info->hasWork);
+            return RC_ASYNC_INIT_FAILED;
+        }
     }
+    return RC_OK;
+}
 
-	//move to the end of file
-    fseek(page_file, 0, SEEK_END);
-    // Write the empty block to the file
-    fwrite(emptyBlock, sizeof(char), PAGE_SIZE, page_file);
+static void freeAsyncInfo (SM_AsyncInfo *info)
+{
+    free(info->requests);
+    free(info->freeSlots);
+    free(info->ready);
+    free(info->workers);
+    free(info->pending);
+    pthread_cond_destroy(&info->completed);
+    pthread_mutex_destroy(&info->lock);
+    free(info);
+}
 
 
-    // Update total number of pages and current page position in file handle
-    // total number of pages that are stored on file is increased by 1
-    fHandle->totalNumPages++;
+// set up an asynchronous I/O engine that keeps up to queueDepth block reads/writes in flight.
+// backend SM_ASYNC_DEFAULT uses io_uring where the kernel supports it and worker threads otherwise
+extern RC initAsyncEngine (SM_AsyncEngine *engine, int queueDepth, int backend)
+{
+    if (engine == NULL || queueDepth <= 0)
+        return RC_ASYNC_INIT_FAILED;
+
+    SM_AsyncInfo *info = (SM_AsyncInfo *)calloc(1, sizeof(SM_AsyncInfo));
+    if (info == NULL)
+        return RC_ASYNC_INIT_FAILED;
+
+    pthread_mutex_init(&info->lock, NULL);
+    pthread_cond_init(&info->completed, NULL);
+    info->requests = (SM_AsyncRequest *)calloc(queueDepth, sizeof(SM_AsyncRequest));
+    info->freeSlots = (int *)malloc(sizeof(int) * queueDepth);
+    info->ready = (int *)malloc(sizeof(int) * queueDepth);
+    if (info->requests == NULL || info->freeSlots == NULL || info->ready == NULL)
+    {
+        freeAsyncInfo(info);
+        return RC_ASYNC_INIT_FAILED;
+    }
+    for (int i = 0; i < queueDepth; i++)
+        info->freeSlots[i] = queueDepth - 1 - i;
+    info->numFree = queueDepth;
+    info->queueDepth = queueDepth;
+
+    RC rc = RC_ASYNC_INIT_FAILED;
+#ifdef SM_HAVE_IO_URING
+    if (backend == SM_ASYNC_DEFAULT || backend == SM_ASYNC_IO_URING)
+    {
+        rc = initIoUring(info, queueDepth);
+        if (rc == RC_OK)
+            backend = SM_ASYNC_IO_URING;
+    }
+#endif
+    if (rc != RC_OK && (backend == SM_ASYNC_DEFAULT || backend == SM_ASYNC_THREADS))
+    {
+        rc = initAsyncWorkers(info, queueDepth);
+        if (rc == RC_OK)
+            backend = SM_ASYNC_THREADS;
+    }
+    if (rc != RC_OK)
+    {
+        freeAsyncInfo(info);
+        return rc;
+    }
 
-    // Return success
+    engine->queueDepth = queueDepth;
+    engine->backend = backend;
+    engine->mgmtInfo = info;
     return RC_OK;
 }
 
-//ensures the file has at least the specified number of pages. 
-//If the file already has enough pages, it does nothing. 
-//If not, it appends empty pages until the desired capacity is reached.
-extern RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) 
+// wait for all requests still in flight, stop the backend and release the engine.
+// completions that were never collected with pollCompletions are dropped
+extern RC shutdownAsyncEngine (SM_AsyncEngine *engine)
 {
-    // Check if file handle is valid
-    if (fHandle == NULL || fHandle->mgmtInfo == NULL || fHandle->fileName == NULL)
-        return RC_FILE_NOT_FOUND;
+    if (engine == NULL || engine->mgmtInfo == NULL)
+        return RC_ASYNC_INIT_FAILED;
 
-    // Calculate the difference between the requested number of pages and the current total number of pages
-    int pagesToAdd = numberOfPages - fHandle->totalNumPages;
+    SM_AsyncInfo *info = (SM_AsyncInfo *)engine->mgmtInfo;
 
-    // If no additional pages are needed, return success
-    if (pagesToAdd <= 0)
-        return RC_OK;
+#ifdef SM_HAVE_IO_URING
+    if (engine->backend == SM_ASYNC_IO_URING)
+    {
+        pthread_mutex_lock(&info->lock);
+        reapIoUring(info);
+        while (info->inFlight > 0)
+        {
+            ioUringEnter(info->ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+            reapIoUring(info);
+        }
+        pthread_mutex_unlock(&info->lock);
+        shutdownIoUring(info);
+    }
+#endif
+    if (engine->backend == SM_ASYNC_THREADS)
+    {
+        // workers finish the queued requests before they exit
+        pthread_mutex_lock(&info->lock);
+        info->stopping = 1;
+        pthread_cond_broadcast(&info->hasWork);
+        pthread_mutex_unlock(&info->lock);
+        for (int i = 0; i < info->numWorkers; i++)
+            pthread_join(info->workers[i], NULL);
+        pthread_cond_destroy(&info->hasWork);
+    }
+
+    freeAsyncInfo(info);
+    engine->mgmtInfo = NULL;
+    return RC_OK;
+}
+
+// queue one block read or write. returns RC_ASYNC_QUEUE_FULL if queueDepth requests are outstanding;
+// the caller then has to collect completions with pollCompletions first
+static RC submitRequest (SM_AsyncEngine *engine, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage,
+                         void *userData, int isWrite)
+{
+    if (engine == NULL || engine->mgmtInfo == NULL)
+        return RC_ASYNC_INIT_FAILED;
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || memPage == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (pageNum < 0 || pageNum >= LOAD_RELAXED(fHandle->totalNumPages))
+        return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
 
-    // Add the required number of empty blocks to meet the capacity
-    while (pagesToAdd > 0) {
-        RC appendStatus = appendEmptyBlock(fHandle);
-        if (appendStatus != RC_OK)
-            return appendStatus;
+    SM_AsyncInfo *info = (SM_AsyncInfo *)engine->mgmtInfo;
+    SM_FileInfo *file_info = (SM_FileInfo *)fHandle->mgmtInfo;
 
-        pagesToAdd--;
+    pthread_mutex_lock(&info->lock);
+    if (info->numFree == 0)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return RC_ASYNC_QUEUE_FULL;
+    }
+
+    int slot = info->freeSlots[--info->numFree];
+    SM_AsyncRequest *request = &info->requests[slot];
+    request->file_info = file_info;
+    request->pageNum = pageNum;
+    request->isWrite = isWrite;
+    request->memPage = memPage;
+    request->userData = userData;
+    request->rc = RC_OK;
+    info->inFlight++;
+
+    // a mapped or memory file is only a memcpy, and direct I/O with an unaligned buffer needs the bounce page:
+    // these are completed right away in the calling thread. io_uring can only serve the pread/pwrite file backend
+    int synchronous = (file_info->backend == &mmapBackend) || (file_info->backend == &memoryBackend) ||
+                      (file_info->backend != &fileBackend && engine->backend == SM_ASYNC_IO_URING) ||
+                      ((file_info->flags & SM_OPEN_DIRECT) && !isPageAligned(memPage));
+
+    RC rc = RC_OK;
+    if (synchronous)
+        completeRequest(info, slot, performRequest(request));
+#ifdef SM_HAVE_IO_URING
+    else if (engine->backend == SM_ASYNC_IO_URING)
+    {
+        // a request the kernel did not take is no longer on the ring, it completes as failed here
+        rc = submitIoUring(info, slot);
+        if (rc != RC_OK)
+            completeRequest(info, slot, rc);
     }
+#endif
+    else
+    {
+        info->pending[(info->pendingHead + info->pendingCount) % engine->queueDepth] = slot;
+        info->pendingCount++;
+        pthread_cond_signal(&info->hasWork);
+    }
+    pthread_mutex_unlock(&info->lock);
 
-    // Return success
+    // a failed submission is still reported through pollCompletions, the request was accepted
     return RC_OK;
 }
+
+// start reading page pageNum into memPage. the buffer must stay valid until the completion is polled
+extern RC submitRead (SM_AsyncEngine *engine, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData)
+{
+    return submitRequest(engine, pageNum, fHandle, memPage, userData, 0);
+}
+
+// start writing memPage to page pageNum. the buffer must stay valid until the completion is polled
+extern RC submitWrite (SM_AsyncEngine *engine, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData)
+{
+    return submitRequest(engine, pageNum, fHandle, memPage, userData, 1);
+}
+
+// collect up to maxCompletions finished requests into completions[], waiting until at least
+// minCompletions are available (0 = do not wait). waiting stops early when nothing is in flight any more.
+// returns the number of completions stored, -1 for an invalid engine
+extern int pollCompletions (SM_AsyncEngine *engine, SM_IOCompletion *completions, int maxCompletions, int minCompletions)
+{
+    if (engine == NULL || engine->mgmtInfo == NULL || completions == NULL || maxCompletions <= 0)
+        return -1;
+
+    SM_AsyncInfo *info = (SM_AsyncInfo *)engine->mgmtInfo;
+    if (minCompletions > maxCompletions)
+        minCompletions = maxCompletions;
+
+    pthread_mutex_lock(&info->lock);
+    while (1)
+    {
+#ifdef SM_HAVE_IO_URING
+        if (engine->backend == SM_ASYNC_IO_URING)
+            reapIoUring(info);
+#endif
+        if (info->readyCount >= minCompletions || info->inFlight == 0)
+            break;
+
+#ifdef SM_HAVE_IO_URING
+        if (engine->backend == SM_ASYNC_IO_URING)
+        {
+            // wait in the kernel for one more completion, without blocking submitters
+            pthread_mutex_unlock(&info->lock);
+            ioUringEnter(info->ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+            pthread_mutex_lock(&info->lock);
+            continue;
+        }
+#endif
+        pthread_cond_wait(&info->completed, &info->lock);
+    }
+
+    int count = 0;
+    while (count < maxCompletions && info->readyCount > 0)
+    {
+        int slot = info->ready[info->readyHead];
+        info->readyHead = (info->readyHead + 1) % engine->queueDepth;
+        info->readyCount--;
+
+        SM_AsyncRequest *request = &info->requests[slot];
+        completions[count].pageNum = request->pageNum;
+        completions[count].isWrite = request->isWrite;
+        completions[count].rc = request->rc;
+        completions[count].memPage = request->memPage;
+        completions[count].userData = request->userData;
+        count++;
+
+        info->freeSlots[info->numFree++] = slot;
+    }
+    pthread_mutex_unlock(&info->lock);
+
+    return count;
+}
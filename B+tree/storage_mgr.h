@@ -11,33 +11,162 @@ typedef struct SM_FileHandle {
 	int totalNumPages;
 	int curPagePos;
 	void *mgmtInfo;
+	int pageSize;		/* size of a page of this file in bytes */
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+/* asynchronous I/O engine */
+typedef struct SM_AsyncEngine {
+	int queueDepth;		/* maximum number of requests in flight */
+	int backend;		/* SM_ASYNC_IO_URING or SM_ASYNC_THREADS */
+	void *mgmtInfo;
+} SM_AsyncEngine;
+
+/* a finished asynchronous request, returned by pollCompletions */
+typedef struct SM_IOCompletion {
+	int pageNum;
+	int isWrite;
+	RC rc;
+	SM_PageHandle memPage;
+	void *userData;		/* as passed to submitRead/submitWrite */
+} SM_IOCompletion;
+
+/* buckets of the latency histograms in SM_IOStats: bucket 0 counts calls that took less than 1 us,
+   bucket i > 0 calls of 2^(i-1) us up to 2^i us; the last bucket also counts all slower calls */
+#define SM_LATENCY_BUCKETS 24
+
+/* I/O statistics of an open page file, see getIOStats */
+typedef struct SM_IOStats {
+	unsigned long long reads;		/* readBlock/readBlockRange calls */
+	unsigned long long writes;		/* writeBlock/writeBlockRange calls */
+	unsigned long long pagesRead;
+	unsigned long long pagesWritten;
+	unsigned long long bytesRead;		/* bytes moved by system calls (compressed files: compressed bytes) */
+	unsigned long long bytesWritten;
+	unsigned long long syscalls;		/* read, write and sync calls (stdio backend: library calls) */
+	unsigned long long seeks;		/* reads and writes that did not continue where the previous one ended */
+	unsigned long long extensions;		/* times the file grew */
+	unsigned long long syncs;		/* fdatasync/msync calls */
+	unsigned long long readNs;		/* time spent in readBlock/readBlockRange */
+	unsigned long long writeNs;		/* time spent in writeBlock/writeBlockRange, syncs included */
+	unsigned long long ioWaitNs;		/* time spent in the system calls counted in syscalls */
+	unsigned long long readLatency[SM_LATENCY_BUCKETS];
+	unsigned long long writeLatency[SM_LATENCY_BUCKETS];
+} SM_IOStats;
+
+/* backends for initAsyncEngine */
+#define SM_ASYNC_DEFAULT  0	/* io_uring if available, worker threads otherwise */
+#define SM_ASYNC_IO_URING 1
+#define SM_ASYNC_THREADS  2
+
+/* alignment of page buffers used with SM_OPEN_DIRECT */
+#define SM_PAGE_ALIGNMENT 4096
+
+/* page sizes accepted by createPageFileWithPageSize (powers of two) */
+#define SM_MIN_PAGE_SIZE 4096
+#define SM_MAX_PAGE_SIZE 65536
+
+/* size of the header block in front of page 0 */
+#define SM_HEADER_SIZE 4096
+
+/* growth policies for setGrowthPolicy */
+#define SM_GROW_PREALLOCATE 0	/* reserve disk space in extents with fallocate */
+#define SM_GROW_SPARSE      1	/* only extend the end of file with ftruncate */
+
+/* sync policies for setSyncPolicy */
+#define SM_SYNC_NONE  0	/* leave write back to the OS */
+#define SM_SYNC_WRITE 1	/* fdatasync after every write */
+#define SM_SYNC_GROUP 2	/* writes close together share one fdatasync */
+
+/* storage backends for setStorageBackend */
+#define SM_BACKEND_FILE   0	/* page files on disk, positional pread/pwrite (default) */
+#define SM_BACKEND_STDIO  1	/* page files on disk, buffered stdio streams */
+#define SM_BACKEND_MMAP   2	/* page files on disk mapped into memory, as with SM_OPEN_MAPPED */
+#define SM_BACKEND_MEMORY 3	/* page files kept in process memory, nothing is written to disk */
+
+/* advice for adviseAccess */
+#define SM_ADVICE_NORMAL     0	/* no particular access pattern */
+#define SM_ADVICE_SEQUENTIAL 1	/* pages are read in order: read further ahead */
+#define SM_ADVICE_RANDOM     2	/* pages are read in no order: do not read ahead */
+#define SM_ADVICE_WILLNEED   3	/* the pages are needed soon: start reading them */
+#define SM_ADVICE_DONTNEED   4	/* the pages are not needed soon: drop them from the cache */
+#define SM_ADVICE_AUTO       5	/* pick sequential or random from the reads (default) */
+
+/* flags for openPageFileFlags */
+#define SM_OPEN_DEFAULT 0
+#define SM_OPEN_DIRECT  1	/* bypass the OS page cache (O_DIRECT) */
+#define SM_OPEN_MAPPED  2	/* map the file into memory */
+#define SM_OPEN_SEGMENTED 4	/* store the file in segment files of SM_SEGMENT_PAGES pages */
+
+/* pages per segment file of a segmented page file (1 GB with 4 KB pages) */
+#ifndef SM_SEGMENT_PAGES
+#define SM_SEGMENT_PAGES 262144
+#endif
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
+extern RC setStorageBackend (int backend);
+extern int getStorageBackend (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithPageSize (char *fileName, int pageSize);
+extern RC createCompressedPageFile (char *fileName, int pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileMapped (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileFlags (char *fileName, SM_FileHandle *fHandle, int flags);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
+/* page buffers */
+extern SM_PageHandle allocAlignedPage (void);
+extern SM_PageHandle allocAlignedBuffer (int size);
+extern void freeAlignedPage (SM_PageHandle page);
+
 /* reading blocks from disc */
 extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern int getBlockPos (SM_FileHandle *fHandle);
+extern SM_PageHandle getBlockPointer (int pageNum, SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlockRange (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *pages);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlockRange (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *pages);
+extern RC writeBlockRangeSync (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *pages, int syncPolicy);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC setGrowthPolicy (SM_FileHandle *fHandle, int policy, int extentPages);
+extern int getAllocatedPages (SM_FileHandle *fHandle);
+extern RC truncatePageFile (int numberOfPages, SM_FileHandle *fHandle);
+extern RC discardBlockRange (int startPage, int numPages, SM_FileHandle *fHandle);
+extern RC adviseAccess (SM_FileHandle *fHandle, int advice, int startPage, int numPages);
+
+/* page allocation */
+extern RC allocatePage (SM_FileHandle *fHandle, int *pageNum);
+extern RC freePage (int pageNum, SM_FileHandle *fHandle);
+extern int getFreePageCount (SM_FileHandle *fHandle);
+
+/* durability */
+extern RC setSyncPolicy (SM_FileHandle *fHandle, int policy, int intervalUs, int batchWrites);
+extern RC syncPageFile (SM_FileHandle *fHandle);
+
+/* statistics */
+extern RC getIOStats (SM_FileHandle *fHandle, SM_IOStats *stats);
+extern RC resetIOStats (SM_FileHandle *fHandle);
+
+/* asynchronous block I/O */
+extern RC initAsyncEngine (SM_AsyncEngine *engine, int queueDepth, int backend);
+extern RC shutdownAsyncEngine (SM_AsyncEngine *engine);
+extern RC submitRead (SM_AsyncEngine *engine, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern RC submitWrite (SM_AsyncEngine *engine, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern int pollCompletions (SM_AsyncEngine *engine, SM_IOCompletion *completions, int maxCompletions, int minCompletions);
 
 #endif
@@ -0,0 +1,774 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "storage_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_pagefile.bin"
+
+/* prototypes for test functions */
+static void testBlockRange(void);
+static void testDirectIO(void);
+static void testAsyncEngine(void);
+static void testSegmentedFile(void);
+static void testPageSizeHeader(void);
+static void testBackends(void);
+static void testCompressedFile(void);
+static void testPageAllocation(void);
+static void testDiscardPages(void);
+static void testAdviseAccess(void);
+static void testGroupCommit(void);
+
+/* helpers: fill a page with a pattern derived from seed, and check it */
+static void fillPage(SM_PageHandle ph, int seed);
+static int pageMatches(SM_PageHandle ph, int seed);
+static void *writePages(void *arg);
+
+/* work of one thread of testGroupCommit: write pages firstPage .. firstPage + numPages - 1 */
+typedef struct WriteWork {
+  SM_FileHandle *fh;
+  int firstPage;
+  int numPages;
+  int errors;
+} WriteWork;
+
+/* main function running all tests */
+int
+main (void)
+{
+  testName = "";
+  
+  initStorageManager();
+
+  testBlockRange();
+  testDirectIO();
+  testAsyncEngine();
+  testSegmentedFile();
+  testPageSizeHeader();
+  testBackends();
+  testCompressedFile();
+  testPageAllocation();
+  testDiscardPages();
+  testAdviseAccess();
+  testGroupCommit();
+
+  return 0;
+}
+
+
+void
+fillPage(SM_PageHandle ph, int seed)
+{
+  int i;
+
+  for (i = 0; i < PAGE_SIZE; i++)
+    ph[i] = (i % 7 == 0) ? (seed + i / 7) % 128 : 0;
+}
+
+int
+pageMatches(SM_PageHandle ph, int seed)
+{
+  int i;
+
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (ph[i] != ((i % 7 == 0) ? (seed + i / 7) % 128 : 0))
+      return 0;
+  return 1;
+}
+
+void *
+writePages(void *arg)
+{
+  WriteWork *work = (WriteWork *) arg;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  int i;
+
+  for (i = work->firstPage; i < work->firstPage + work->numPages; i++)
+    {
+      fillPage(ph, i);
+      if (writeBlock (i, work->fh, ph) != RC_OK)
+        work->errors++;
+    }
+  free(ph);
+  return NULL;
+}
+
+/* write pages in ranges and read them back in other ranges and one by one */
+void
+testBlockRange(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle pages[8];
+  SM_PageHandle ph;
+  int i;
+
+  testName = "test readBlockRange and writeBlockRange";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  for (i = 0; i < 8; i++)
+    pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (16, &fh));
+
+  // pages 0-7 in one range, 8-15 in two
+  for (i = 0; i < 8; i++)
+    fillPage(pages[i], i);
+  TEST_CHECK(writeBlockRange (0, 8, &fh, pages));
+  ASSERT_EQUALS_INT(7, getBlockPos(&fh), "position is the last page written");
+  for (i = 0; i < 8; i++)
+    fillPage(pages[i], 8 + i);
+  TEST_CHECK(writeBlockRange (8, 3, &fh, pages));
+  TEST_CHECK(writeBlockRange (11, 5, &fh, &pages[3]));
+
+  // a range across both writes
+  TEST_CHECK(readBlockRange (4, 8, &fh, pages));
+  for (i = 0; i < 8; i++)
+    ASSERT_TRUE(pageMatches(pages[i], 4 + i), "range read returns the pages written");
+  ASSERT_EQUALS_INT(11, getBlockPos(&fh), "position is the last page read");
+  for (i = 0; i < 16; i++)
+    {
+      TEST_CHECK(readBlock (i, &fh, ph));
+      ASSERT_TRUE(pageMatches(ph, i), "single page read returns the page written in a range");
+    }
+
+  // ranges that do not fit the file
+  ASSERT_ERROR(readBlockRange (12, 8, &fh, pages), "reading past the end of file");
+  ASSERT_ERROR(writeBlockRange (-1, 2, &fh, pages), "writing before page 0");
+  ASSERT_ERROR(writeBlockRange (0, 0, &fh, pages), "writing no pages");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  for (i = 0; i < 8; i++)
+    free(pages[i]);
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* a file opened with SM_OPEN_DIRECT takes aligned buffers as they are and unaligned ones through a bounce page */
+void
+testDirectIO(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle aligned[4];
+  SM_PageHandle unalignedMem[4];
+  SM_PageHandle pages[4];
+  SM_PageHandle ph;
+  int i;
+
+  testName = "test direct I/O with aligned and unaligned buffers";
+
+  // the unaligned buffers are one byte into a malloc'ed block
+  for (i = 0; i < 4; i++)
+    {
+      aligned[i] = allocAlignedPage();
+      unalignedMem[i] = (SM_PageHandle) malloc(PAGE_SIZE + 1);
+      ASSERT_TRUE(aligned[i] != NULL, "aligned page allocated");
+    }
+  ph = allocAlignedBuffer(4 * PAGE_SIZE);
+  ASSERT_TRUE(ph != NULL, "aligned buffer allocated");
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFileFlags (TESTPF, &fh, SM_OPEN_DIRECT));
+  TEST_CHECK(ensureCapacity (8, &fh));
+
+  // single pages from both kinds of buffer, each read back into the other kind
+  fillPage(aligned[0], 0);
+  TEST_CHECK(writeBlock (0, &fh, aligned[0]));
+  fillPage(unalignedMem[0] + 1, 1);
+  TEST_CHECK(writeBlock (1, &fh, unalignedMem[0] + 1));
+  TEST_CHECK(readBlock (0, &fh, unalignedMem[1] + 1));
+  ASSERT_TRUE(pageMatches(unalignedMem[1] + 1, 0), "aligned write read into an unaligned buffer");
+  TEST_CHECK(readBlock (1, &fh, aligned[1]));
+  ASSERT_TRUE(pageMatches(aligned[1], 1), "unaligned write read through the bounce page");
+
+  // ranges of mixed buffers go page by page, aligned ones in one piece
+  for (i = 0; i < 4; i++)
+    {
+      pages[i] = (i % 2 == 0) ? aligned[i] : unalignedMem[i] + 1;
+      fillPage(pages[i], 2 + i);
+    }
+  TEST_CHECK(writeBlockRange (2, 4, &fh, pages));
+  for (i = 0; i < 4; i++)
+    {
+      pages[i] = (i % 2 == 0) ? unalignedMem[i] + 1 : aligned[i];
+      memset(pages[i], 0, PAGE_SIZE);
+    }
+  TEST_CHECK(readBlockRange (2, 4, &fh, pages));
+  for (i = 0; i < 4; i++)
+    ASSERT_TRUE(pageMatches(pages[i], 2 + i), "mixed range read returns the pages written");
+  for (i = 0; i < 4; i++)
+    pages[i] = ph + i * PAGE_SIZE;
+  TEST_CHECK(readBlockRange (0, 4, &fh, pages));
+  for (i = 0; i < 4; i++)
+    ASSERT_TRUE(pageMatches(pages[i], i), "aligned range read returns the pages written");
+
+  // the pages are on disk for a buffered open as well
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < 6; i++)
+    {
+      TEST_CHECK(readBlock (i, &fh, unalignedMem[0] + 1));
+      ASSERT_TRUE(pageMatches(unalignedMem[0] + 1, i), "page written with direct I/O");
+    }
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  for (i = 0; i < 4; i++)
+    {
+      freeAlignedPage(aligned[i]);
+      free(unalignedMem[i]);
+    }
+  freeAlignedPage(ph);
+
+  TEST_DONE();
+}
+
+/* write pages through the asynchronous engine, with worker threads and with the default backend, and read them back */
+void
+testAsyncEngine(void)
+{
+  int backends[] = { SM_ASYNC_THREADS, SM_ASYNC_DEFAULT };
+  SM_AsyncEngine engine;
+  SM_FileHandle fh;
+  SM_IOCompletion completions[4];
+  SM_PageHandle pages[4];
+  int ids[4];
+  int b, i, n;
+  RC rc;
+
+  testName = "test asynchronous engine";
+
+  for (i = 0; i < 4; i++)
+    {
+      pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+      ids[i] = i;
+    }
+
+  for (b = 0; b < 2; b++)
+    {
+      TEST_CHECK(createPageFile (TESTPF));
+      TEST_CHECK(openPageFile (TESTPF, &fh));
+      TEST_CHECK(ensureCapacity (8, &fh));
+      TEST_CHECK(initAsyncEngine (&engine, 4, backends[b]));
+
+      // pages 4-7, one request each; the queue holds no more than 4
+      for (i = 0; i < 4; i++)
+        {
+          fillPage(pages[i], 4 + i);
+          TEST_CHECK(submitWrite (&engine, 4 + i, &fh, pages[i], &ids[i]));
+        }
+      rc = submitWrite (&engine, 0, &fh, pages[0], NULL);
+      ASSERT_EQUALS_INT(RC_ASYNC_QUEUE_FULL, rc, "queue is full");
+      rc = submitWrite (&engine, 8, &fh, pages[0], NULL);
+      ASSERT_EQUALS_INT(RC_WRITE_FAILED, rc, "page past the end of file");
+
+      n = pollCompletions (&engine, completions, 4, 4);
+      ASSERT_EQUALS_INT(4, n, "all writes complete");
+      for (i = 0; i < n; i++)
+        {
+          int id = *(int *) completions[i].userData;
+          TEST_CHECK(completions[i].rc);
+          ASSERT_TRUE(completions[i].isWrite, "completion of a write");
+          ASSERT_EQUALS_INT(4 + id, completions[i].pageNum, "completion carries the page of its request");
+          ASSERT_TRUE(completions[i].memPage == pages[id], "completion carries the buffer of its request");
+        }
+      n = pollCompletions (&engine, completions, 4, 1);
+      ASSERT_EQUALS_INT(0, n, "nothing is left in flight");
+
+      // read them back in reverse order, collecting the completions one at a time
+      for (i = 0; i < 4; i++)
+        {
+          memset(pages[i], 0, PAGE_SIZE);
+          TEST_CHECK(submitRead (&engine, 7 - i, &fh, pages[i], &ids[i]));
+        }
+      for (i = 0; i < 4; i++)
+        {
+          n = pollCompletions (&engine, completions, 1, 1);
+          ASSERT_EQUALS_INT(1, n, "one read completes");
+          TEST_CHECK(completions[0].rc);
+          ASSERT_TRUE(!completions[0].isWrite, "completion of a read");
+        }
+      for (i = 0; i < 4; i++)
+        ASSERT_TRUE(pageMatches(pages[i], 7 - i), "asynchronous read returns the page written");
+
+      TEST_CHECK(shutdownAsyncEngine (&engine));
+      TEST_CHECK(closePageFile (&fh));
+      TEST_CHECK(destroyPageFile (TESTPF));
+    }
+
+  for (i = 0; i < 4; i++)
+    free(pages[i]);
+
+  TEST_DONE();
+}
+
+/* grow a segmented file into its second segment, write across the boundary, reopen and shrink it again */
+void
+testSegmentedFile(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle pages[2];
+  int last = SM_SEGMENT_PAGES - 1;
+  char segment1[64];
+  int i;
+
+  testName = "test segmented page files";
+
+  snprintf(segment1, sizeof(segment1), "%s.seg1", TESTPF);
+  for (i = 0; i < 2; i++)
+    pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFileFlags (TESTPF, &fh, SM_OPEN_SEGMENTED));
+  TEST_CHECK(setGrowthPolicy (&fh, SM_GROW_SPARSE, 0));
+  ASSERT_TRUE(access(segment1, F_OK) != 0, "a small file has one segment");
+
+  // the last page of segment 0 and the first of segment 1, in one range
+  TEST_CHECK(ensureCapacity (SM_SEGMENT_PAGES + 2, &fh));
+  ASSERT_TRUE(access(segment1, F_OK) == 0, "growing past a segment creates the next one");
+  fillPage(pages[0], 1);
+  fillPage(pages[1], 2);
+  TEST_CHECK(writeBlockRange (last, 2, &fh, pages));
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFileFlags (TESTPF, &fh, SM_OPEN_SEGMENTED));
+  ASSERT_EQUALS_INT(SM_SEGMENT_PAGES + 2, fh.totalNumPages, "reopened file has the pages of both segments");
+  TEST_CHECK(readBlock (last, &fh, pages[0]));
+  ASSERT_TRUE(pageMatches(pages[0], 1), "last page of segment 0");
+  TEST_CHECK(readBlock (last + 1, &fh, pages[1]));
+  ASSERT_TRUE(pageMatches(pages[1], 2), "first page of segment 1");
+  TEST_CHECK(readBlockRange (last, 2, &fh, pages));
+  ASSERT_TRUE(pageMatches(pages[0], 1) && pageMatches(pages[1], 2), "range read across the segments");
+
+  // shrinking below the boundary removes segment 1
+  TEST_CHECK(truncatePageFile (4, &fh));
+  ASSERT_TRUE(access(segment1, F_OK) != 0, "truncating removes the segments past the end");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  for (i = 0; i < 2; i++)
+    free(pages[i]);
+
+  TEST_DONE();
+}
+
+/* a page size other than PAGE_SIZE is recorded in the header block and used again when the file is reopened */
+void
+testPageSizeHeader(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i;
+
+  testName = "test page size in the header block";
+
+  ASSERT_ERROR(createPageFileWithPageSize (TESTPF, 3000), "page size that is no power of two");
+  ASSERT_ERROR(createPageFileWithPageSize (TESTPF, SM_MIN_PAGE_SIZE / 2), "page size below the minimum");
+  ASSERT_ERROR(createPageFileWithPageSize (TESTPF, SM_MAX_PAGE_SIZE * 2), "page size above the maximum");
+
+  TEST_CHECK(createPageFileWithPageSize (TESTPF, 16384));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(16384, fh.pageSize, "page size of the new file");
+  ASSERT_EQUALS_INT(1, fh.totalNumPages, "new file has one page");
+
+  // pages of the file size: the last byte of page 1 is written and read back
+  ph = (SM_PageHandle) calloc(1, 16384);
+  TEST_CHECK(ensureCapacity (3, &fh));
+  ph[0] = 'a';
+  ph[16383] = 'z';
+  TEST_CHECK(writeBlock (1, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(16384, fh.pageSize, "reopened file keeps its page size");
+  ASSERT_EQUALS_INT(3, fh.totalNumPages, "reopened file keeps its pages");
+  memset(ph, 0, 16384);
+  TEST_CHECK(readBlock (1, &fh, ph));
+  ASSERT_TRUE(ph[0] == 'a' && ph[16383] == 'z', "whole page read back");
+  TEST_CHECK(readBlock (2, &fh, ph));
+  for (i = 0; i < 16384; i++)
+    if (ph[i] != 0)
+      break;
+  ASSERT_EQUALS_INT(16384, i, "new page is empty");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* the same round trip through every storage backend: write, close, reopen, read, destroy */
+void
+testBackends(void)
+{
+  int backends[] = { SM_BACKEND_FILE, SM_BACKEND_STDIO, SM_BACKEND_MMAP, SM_BACKEND_MEMORY };
+  SM_FileHandle fh;
+  SM_PageHandle pages[2];
+  SM_PageHandle ph;
+  int b, i;
+
+  testName = "test storage backends";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  for (i = 0; i < 2; i++)
+    pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+  ASSERT_ERROR(setStorageBackend (-1), "unknown backend");
+
+  for (b = 0; b < 4; b++)
+    {
+      TEST_CHECK(setStorageBackend (backends[b]));
+      ASSERT_EQUALS_INT(backends[b], getStorageBackend(), "backend is selected");
+
+      TEST_CHECK(createPageFile (TESTPF));
+      TEST_CHECK(openPageFile (TESTPF, &fh));
+      TEST_CHECK(ensureCapacity (4, &fh));
+      for (i = 0; i < 4; i++)
+        {
+          fillPage(ph, 10 * b + i);
+          TEST_CHECK(writeBlock (i, &fh, ph));
+        }
+      fillPage(pages[0], 10 * b + 4);
+      fillPage(pages[1], 10 * b + 5);
+      TEST_CHECK(appendEmptyBlock (&fh));
+      TEST_CHECK(appendEmptyBlock (&fh));
+      TEST_CHECK(writeBlockRange (4, 2, &fh, pages));
+      TEST_CHECK(closePageFile (&fh));
+
+      TEST_CHECK(openPageFile (TESTPF, &fh));
+      ASSERT_EQUALS_INT(6, fh.totalNumPages, "reopened file has all pages");
+      for (i = 0; i < 6; i++)
+        {
+          TEST_CHECK(readBlock (i, &fh, ph));
+          ASSERT_TRUE(pageMatches(ph, 10 * b + i), "page read back through the backend");
+        }
+      TEST_CHECK(readBlockRange (4, 2, &fh, pages));
+      ASSERT_TRUE(pageMatches(pages[0], 10 * b + 4) && pageMatches(pages[1], 10 * b + 5), "range read back through the backend");
+      TEST_CHECK(closePageFile (&fh));
+
+      TEST_CHECK(destroyPageFile (TESTPF));
+      ASSERT_TRUE(openPageFile (TESTPF, &fh) != RC_OK, "destroyed file cannot be opened");
+    }
+  TEST_CHECK(setStorageBackend (SM_BACKEND_FILE));
+
+  for (i = 0; i < 2; i++)
+    free(pages[i]);
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* pages of a compressed file are read back unchanged, also after a page was rewritten with content that compresses worse */
+void
+testCompressedFile(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  SM_IOStats stats;
+  unsigned seed = 42;
+  int i;
+
+  testName = "test compressed page files";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createCompressedPageFile (TESTPF, PAGE_SIZE));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (8, &fh));
+  TEST_CHECK(resetIOStats (&fh));
+  for (i = 0; i < 8; i++)
+    {
+      fillPage(ph, i);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+  TEST_CHECK(getIOStats (&fh, &stats));
+  ASSERT_TRUE(stats.bytesWritten < 8 * PAGE_SIZE / 2, "compressible pages take less than half their size");
+
+  // page 3 becomes incompressible noise, larger than the extent it had
+  for (i = 0; i < PAGE_SIZE; i++)
+    ph[i] = rand_r(&seed) % 256;
+  TEST_CHECK(writeBlock (3, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(8, fh.totalNumPages, "reopened file has all pages");
+  for (i = 0; i < 8; i++)
+    if (i != 3)
+      {
+        TEST_CHECK(readBlock (i, &fh, ph));
+        ASSERT_TRUE(pageMatches(ph, i), "compressed page read back");
+      }
+  TEST_CHECK(readBlock (3, &fh, ph));
+  seed = 42;
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (ph[i] != (char) (rand_r(&seed) % 256))
+      break;
+  ASSERT_EQUALS_INT(PAGE_SIZE, i, "incompressible page read back");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* free pages are remembered across a reopen and handed out again, lowest first, as empty pages */
+void
+testPageAllocation(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i, pageNum;
+
+  testName = "test page allocation";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (8, &fh));
+  for (i = 0; i < 8; i++)
+    {
+      fillPage(ph, i);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+
+  // pages 5 and 2 become free; the free last page is cut off
+  TEST_CHECK(freePage (5, &fh));
+  TEST_CHECK(freePage (2, &fh));
+  TEST_CHECK(freePage (5, &fh));
+  ASSERT_EQUALS_INT(2, getFreePageCount(&fh), "freeing a free page again does nothing");
+  TEST_CHECK(freePage (7, &fh));
+  ASSERT_EQUALS_INT(7, fh.totalNumPages, "free last page is cut off");
+  ASSERT_EQUALS_INT(2, getFreePageCount(&fh), "pages inside the file stay free");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(7, fh.totalNumPages, "reopened file keeps its size");
+  ASSERT_EQUALS_INT(2, getFreePageCount(&fh), "reopened file keeps its free pages");
+
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(2, pageNum, "lowest free page is allocated first");
+  TEST_CHECK(readBlock (pageNum, &fh, ph));
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (ph[i] != 0)
+      break;
+  ASSERT_EQUALS_INT(PAGE_SIZE, i, "allocated page is empty");
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(5, pageNum, "next free page");
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(7, pageNum, "without free pages a page is appended");
+  ASSERT_EQUALS_INT(8, fh.totalNumPages, "file grew by the appended page");
+  ASSERT_EQUALS_INT(0, getFreePageCount(&fh), "no free pages are left");
+
+  // the pages that were never freed are untouched
+  for (i = 0; i < 7; i++)
+    if (i != 2 && i != 5)
+      {
+        TEST_CHECK(readBlock (i, &fh, ph));
+        ASSERT_TRUE(pageMatches(ph, i), "allocated page keeps its content");
+      }
+
+  // free pages further apart than one summary word covers (64 * 64 pages) are found in order too
+  TEST_CHECK(ensureCapacity (4200, &fh));
+  TEST_CHECK(freePage (4100, &fh));
+  TEST_CHECK(freePage (70, &fh));
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(70, pageNum, "lowest free page is allocated first");
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(4100, pageNum, "free page in a later summary word");
+  ASSERT_EQUALS_INT(0, getFreePageCount(&fh), "no free pages are left");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* discarded pages read as zeros and give their disk blocks back; the pages around them stay */
+void
+testDiscardPages(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  struct stat before, after;
+  int i, j;
+
+  testName = "test discarding pages";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (64, &fh));
+  for (i = 0; i < 64; i++)
+    {
+      fillPage(ph, i);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+  TEST_CHECK(syncPageFile (&fh));
+  stat(TESTPF, &before);
+
+  TEST_CHECK(discardBlockRange (16, 32, &fh));
+  TEST_CHECK(syncPageFile (&fh));
+  stat(TESTPF, &after);
+  ASSERT_TRUE(after.st_blocks <= before.st_blocks, "discarding does not add disk blocks");
+  ASSERT_EQUALS_INT(64, fh.totalNumPages, "discarding keeps the size of the file");
+
+  for (i = 0; i < 64; i++)
+    {
+      TEST_CHECK(readBlock (i, &fh, ph));
+      if (i >= 16 && i < 48)
+        {
+          for (j = 0; j < PAGE_SIZE; j++)
+            if (ph[j] != 0)
+              break;
+          ASSERT_EQUALS_INT(PAGE_SIZE, j, "discarded page reads as zeros");
+        }
+      else
+        ASSERT_TRUE(pageMatches(ph, i), "page outside the range keeps its content");
+    }
+
+  // a discarded page can be written again
+  fillPage(ph, 99);
+  TEST_CHECK(writeBlock (20, &fh, ph));
+  TEST_CHECK(readBlock (20, &fh, ph));
+  ASSERT_TRUE(pageMatches(ph, 99), "discarded page written again");
+
+  ASSERT_ERROR(discardBlockRange (60, 8, &fh), "range past the end of file");
+  TEST_CHECK(discardBlockRange (10, 0, &fh));
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* access advice is checked against the file; advice never changes what the pages read */
+void
+testAdviseAccess(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i, advice;
+
+  testName = "test access advice";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  ASSERT_ERROR(adviseAccess (NULL, SM_ADVICE_NORMAL, 0, 1), "advice without a file handle");
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (16, &fh));
+  for (i = 0; i < 16; i++)
+    {
+      fillPage(ph, i);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+
+  // every advice on a range inside the file, and on the rest of the file (numPages <= 0)
+  for (advice = SM_ADVICE_NORMAL; advice <= SM_ADVICE_AUTO; advice++)
+    {
+      TEST_CHECK(adviseAccess (&fh, advice, 4, 8));
+      TEST_CHECK(adviseAccess (&fh, advice, 4, 0));
+      TEST_CHECK(adviseAccess (&fh, advice, 15, -1));
+    }
+
+  ASSERT_ERROR(adviseAccess (&fh, -1, 0, 1), "unknown advice");
+  ASSERT_ERROR(adviseAccess (&fh, SM_ADVICE_AUTO + 1, 0, 1), "unknown advice");
+  ASSERT_ERROR(adviseAccess (&fh, SM_ADVICE_NORMAL, -1, 1), "range before the start of file");
+  ASSERT_ERROR(adviseAccess (&fh, SM_ADVICE_NORMAL, 12, 8), "range past the end of file");
+  ASSERT_ERROR(adviseAccess (&fh, SM_ADVICE_NORMAL, 16, 1), "range at the end of file");
+  ASSERT_ERROR(adviseAccess (&fh, SM_ADVICE_NORMAL, 16, 0), "rest of the file is empty");
+
+  // fixed advice turns the detection off, SM_ADVICE_AUTO turns it on again; a scan and probes read the same pages
+  TEST_CHECK(adviseAccess (&fh, SM_ADVICE_RANDOM, 0, 0));
+  for (i = 0; i < 16; i++)
+    {
+      TEST_CHECK(readBlock (i, &fh, ph));
+      ASSERT_TRUE(pageMatches(ph, i), "page read under fixed advice");
+    }
+  TEST_CHECK(adviseAccess (&fh, SM_ADVICE_AUTO, 0, 0));
+  for (i = 0; i < 16; i++)
+    {
+      TEST_CHECK(readBlock (i, &fh, ph));
+      ASSERT_TRUE(pageMatches(ph, i), "page read by a scan");
+    }
+  for (i = 0; i < 16; i++)
+    {
+      TEST_CHECK(readBlock ((i * 7) % 16, &fh, ph));
+      ASSERT_TRUE(pageMatches(ph, (i * 7) % 16), "page read by probes");
+    }
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* threads writing under SM_SYNC_GROUP: every write returns once durable, and writes close together share a sync */
+void
+testGroupCommit(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  SM_IOStats stats;
+  WriteWork work[4];
+  pthread_t threads[4];
+  int t, i;
+
+  testName = "test group commit";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (4 * 50, &fh));
+  ASSERT_ERROR(setSyncPolicy (&fh, 7, 0, 0), "unknown sync policy");
+  TEST_CHECK(setSyncPolicy (&fh, SM_SYNC_GROUP, 2000, 4));
+  TEST_CHECK(resetIOStats (&fh));
+
+  for (t = 0; t < 4; t++)
+    {
+      work[t] = (WriteWork) { .fh = &fh, .firstPage = 50 * t, .numPages = 50, .errors = 0 };
+      pthread_create(&threads[t], NULL, writePages, &work[t]);
+    }
+  for (t = 0; t < 4; t++)
+    {
+      pthread_join(threads[t], NULL);
+      ASSERT_EQUALS_INT(0, work[t].errors, "every write under group commit succeeds");
+    }
+
+  TEST_CHECK(getIOStats (&fh, &stats));
+  ASSERT_TRUE(stats.writes == 200, "all writes are counted");
+  ASSERT_TRUE(stats.syncs > 0 && stats.syncs < 200, "writes share their syncs");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < 4 * 50; i++)
+    {
+      TEST_CHECK(readBlock (i, &fh, ph));
+      ASSERT_TRUE(pageMatches(ph, i), "page written under group commit");
+    }
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
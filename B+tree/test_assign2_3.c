@@ -0,0 +1,640 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// check whether two the content of a buffer pool is the same as an expected content 
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+  do {									\
+    char *real;								\
+    char *_exp = (char *) (expected);                                   \
+    real = sprintPoolContent(bm);					\
+    if (strcmp((_exp),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+    free(real);								\
+  } while(0)
+
+// test methods
+static void testARCScanResistance (void);
+static void testConcurrentPins (void);
+static void testWriterHighWater (void);
+static void testPageTable (void);
+static void testCLOCK (void);
+static void testLFU (void);
+static void testLRU_2 (void);
+static void testPinnedListFrames (void);
+
+// helper methods
+static void pinAndUnpin (BM_BufferPool *bm, PageNumber pageNum);
+static bool isCached (BM_BufferPool *bm, PageNumber pageNum);
+static int countDirty (BM_BufferPool *bm);
+static void checkReferenceString (BM_BufferPool *bm, const int *requests, const char **poolContents, int num);
+static void *pinPages (void *arg);
+
+// work of one thread of testConcurrentPins
+typedef struct PinWork {
+  BM_BufferPool *bm;
+  int numPages;		// pins pages 0 to numPages - 1
+  int pins;
+  unsigned seed;
+  int errors;		// pins that failed or found the wrong page content
+} PinWork;
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testARCScanResistance();
+  testConcurrentPins();
+  testWriterHighWater();
+  testPageTable();
+  testCLOCK();
+  testLFU();
+  testLRU_2();
+  testPinnedListFrames();
+
+  return 0;
+}
+
+// ************************************************************
+void
+pinAndUnpin (BM_BufferPool *bm, PageNumber pageNum)
+{
+  BM_PageHandle h;
+
+  TEST_CHECK(pinPage(bm, &h, pageNum));
+  TEST_CHECK(unpinPage(bm, &h));
+}
+
+bool
+isCached (BM_BufferPool *bm, PageNumber pageNum)
+{
+  PageNumber *frameContents = getFrameContents(bm);
+  bool cached = false;
+  int i;
+
+  for (i = 0; i < bm->numPages; i++)
+    if (frameContents[i] == pageNum)
+      cached = true;
+  free(frameContents);
+  return cached;
+}
+
+// pin and unpin the pages of requests one after another, checking the pool content after each
+void
+checkReferenceString (BM_BufferPool *bm, const int *requests, const char **poolContents, int num)
+{
+  int i;
+
+  for (i = 0; i < num; i++)
+    {
+      pinAndUnpin(bm, requests[i]);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+    }
+}
+
+int
+countDirty (BM_BufferPool *bm)
+{
+  bool *dirtyFlags = getDirtyFlags(bm);
+  int numDirty = 0;
+  int i;
+
+  for (i = 0; i < bm->numPages; i++)
+    if (dirtyFlags[i])
+      numDirty++;
+  free(dirtyFlags);
+  return numDirty;
+}
+
+void *
+pinPages (void *arg)
+{
+  PinWork *work = (PinWork *) arg;
+  BM_PageHandle h;
+  int i;
+
+  for (i = 0; i < work->pins; i++)
+    {
+      PageNumber pageNum = rand_r(&work->seed) % work->numPages;
+      bool write = rand_r(&work->seed) % 4 == 0;
+      BM_LatchMode mode = write ? BM_LATCH_EXCLUSIVE : BM_LATCH_SHARED;
+      int content;
+
+      if (pinPageLatched(work->bm, &h, pageNum, mode) != RC_OK)
+        {
+          work->errors++;
+          continue;
+        }
+      memcpy(&content, h.data, sizeof(int));
+      if (content != pageNum)
+        work->errors++;
+      if (write)
+        {
+          markDirty(work->bm, &h);
+          memcpy(h.data + sizeof(int), &i, sizeof(int));
+        }
+      unpinPageLatched(work->bm, &h, mode);
+    }
+  return NULL;
+}
+
+// ************************************************************
+void
+testARCScanResistance (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *other = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  int i, page;
+
+  testName = "ARC keeps a hot set while a scan passes";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  TEST_CHECK(ensureCapacity(400, &fh));
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_ARC, NULL));
+
+  // the hot set: pages 0-3, referenced twice
+  for (i = 0; i < 2; i++)
+    for (page = 0; page < 4; page++)
+      pinAndUnpin(bm, page);
+
+  // a scan of 300 pages, prefetched ahead, touching each page several times within one use of it:
+  // a second pin while the page is still pinned, then a pin right after the page was unpinned
+  for (i = 0; i < 300; i++)
+    {
+      page = 100 + i;
+      if (i % 8 == 0)
+        TEST_CHECK(prefetchPages(bm, page, 8));
+      TEST_CHECK(pinPage(bm, h, page));
+      TEST_CHECK(pinPage(bm, other, page));
+      TEST_CHECK(unpinPage(bm, other));
+      TEST_CHECK(unpinPage(bm, h));
+      pinAndUnpin(bm, page);
+
+      // the hot set is used every now and then during the scan, and is still cached each time
+      if (i % 50 == 49)
+        for (page = 0; page < 4; page++)
+          {
+            ASSERT_TRUE(isCached(bm, page), "hot page survives the scan");
+            pinAndUnpin(bm, page);
+          }
+    }
+  ASSERT_TRUE(!isCached(bm, 100), "scanned page is evicted");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(other);
+  free(h);
+  free(bm);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testConcurrentPins (void)
+{
+  ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PinWork work[4];
+  pthread_t threads[4];
+  int s, t, i;
+
+  testName = "concurrent pins";
+
+  for (s = 0; s < 6; s++)
+    {
+      TEST_CHECK(createPageFile("testbuffer.bin"));
+      TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 16, strategies[s], NULL));
+      for (i = 0; i < 64; i++)
+        {
+          TEST_CHECK(pinPage(bm, h, i));
+          memcpy(h->data, &i, sizeof(int));
+          TEST_CHECK(markDirty(bm, h));
+          TEST_CHECK(unpinPage(bm, h));
+        }
+      TEST_CHECK(forceFlushPool(bm));
+
+      // hits only: 8 pages fit the pool, after they are read in no thread reads from disk
+      for (i = 0; i < 8; i++)
+        {
+          TEST_CHECK(pinPage(bm, h, i));
+          TEST_CHECK(unpinPage(bm, h));
+        }
+      int readIO = getNumReadIO(bm);
+      for (t = 0; t < 4; t++)
+        {
+          work[t] = (PinWork) { .bm = bm, .numPages = 8, .pins = 20000, .seed = t + 1, .errors = 0 };
+          pthread_create(&threads[t], NULL, pinPages, &work[t]);
+        }
+      for (t = 0; t < 4; t++)
+        {
+          pthread_join(threads[t], NULL);
+          ASSERT_EQUALS_INT(0, work[t].errors, "every pin of a cached page finds it");
+        }
+      ASSERT_EQUALS_INT(readIO, getNumReadIO(bm), "hits read nothing from disk");
+
+      // hits and misses: 64 pages through 16 frames
+      for (t = 0; t < 4; t++)
+        {
+          work[t] = (PinWork) { .bm = bm, .numPages = 64, .pins = 5000, .seed = t + 1, .errors = 0 };
+          pthread_create(&threads[t], NULL, pinPages, &work[t]);
+        }
+      for (t = 0; t < 4; t++)
+        {
+          pthread_join(threads[t], NULL);
+          ASSERT_EQUALS_INT(0, work[t].errors, "every pin finds its page");
+        }
+
+      int *fixCounts = getFixCounts(bm);
+      for (i = 0; i < 16; i++)
+        ASSERT_EQUALS_INT(0, fixCounts[i], "no pins are left");
+      free(fixCounts);
+
+      TEST_CHECK(shutdownBufferPool(bm));
+      TEST_CHECK(destroyPageFile("testbuffer.bin"));
+    }
+
+  free(h);
+  free(bm);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testWriterHighWater (void)
+{
+  BM_PoolOptions options = { .syncPolicy = SM_SYNC_WRITE, .cleanFrames = 10, .dirtyHighWater = 50 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  int i, round, content;
+  RC rc;
+
+  testName = "background writer keeps the dirty frames under the high water mark";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+
+  // a sync policy the storage manager does not know fails the pool
+  options.syncPolicy = -1;
+  rc = initBufferPoolWithOptions(bm, "testbuffer.bin", 20, RS_LRU, NULL, &options);
+  ASSERT_TRUE(rc != RC_OK, "unknown sync policy is refused");
+  options.syncPolicy = SM_SYNC_WRITE;
+
+  TEST_CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 20, RS_LRU, NULL, &options));
+
+  // all 20 pages fit the pool, so only the writer cleans them; 50% of 20 frames is a high water mark of 10
+  for (round = 0; round < 5; round++)
+    for (i = 0; i < 20; i++)
+      {
+        content = round * 20 + i;
+        TEST_CHECK(pinPage(bm, h, i));
+        memcpy(h->data, &content, sizeof(int));
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+        ASSERT_TRUE(countDirty(bm) <= 10, "unpinPage returns under the high water mark");
+      }
+  ASSERT_TRUE(getNumWriteIO(bm) > 0, "the writer wrote pages back");
+
+  // a shutdown refused because of a pinned page flushes nothing and leaves the writer running
+  TEST_CHECK(pinPage(bm, h, 0));
+  rc = shutdownBufferPool(bm);
+  ASSERT_TRUE(rc != RC_OK, "shutdown with a pinned page fails");
+  for (i = 1; i < 20; i++)
+    {
+      content = 4 * 20 + i;
+      TEST_CHECK(pinPage(bm, h, i));
+      memcpy(h->data, &content, sizeof(int));
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+      ASSERT_TRUE(countDirty(bm) <= 10, "the writer still cleans after a failed shutdown");
+    }
+  h->pageNum = 0;
+  TEST_CHECK(unpinPage(bm, h));
+
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // the last version of every page is on disk
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  for (i = 0; i < 20; i++)
+    {
+      TEST_CHECK(readBlock(i, &fh, ph));
+      memcpy(&content, ph, sizeof(int));
+      ASSERT_EQUALS_INT(4 * 20 + i, content, "page holds its last write");
+    }
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(ph);
+  free(h);
+  free(bm);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPageTable (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int timesCached[1000];
+  int i, content;
+
+  testName = "page table of a large pool";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 256, RS_FIFO, NULL));
+
+  // 1000 pages through 256 frames: under FIFO the last 256 stay
+  for (i = 0; i < 1000; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      memcpy(h->data, &i, sizeof(int));
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+
+  PageNumber *frameContents = getFrameContents(bm);
+  memset(timesCached, 0, sizeof(timesCached));
+  for (i = 0; i < 256; i++)
+    {
+      ASSERT_TRUE(frameContents[i] >= 744 && frameContents[i] < 1000, "frame holds one of the last pages");
+      timesCached[frameContents[i]]++;
+    }
+  for (i = 744; i < 1000; i++)
+    ASSERT_EQUALS_INT(1, timesCached[i], "page is cached in one frame");
+  free(frameContents);
+
+  // all of them are found in the table, in any order
+  int readIO = getNumReadIO(bm);
+  for (i = 999; i >= 744; i--)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      memcpy(&content, h->data, sizeof(int));
+      ASSERT_EQUALS_INT(i, content, "cached page found");
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(readIO, getNumReadIO(bm), "cached pages are not read again");
+
+  // evicted pages are gone from the table and read back from disk
+  for (i = 0; i < 744; i += 93)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      memcpy(&content, h->data, sizeof(int));
+      ASSERT_EQUALS_INT(i, content, "evicted page read back");
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(readIO + 8, getNumReadIO(bm), "evicted pages are read again");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(h);
+  free(bm);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testCLOCK (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    // the hand clears every bit in one turn and comes back to frame 0
+    "[3 0],[1 0],[2 0]",
+    // page 1 gets its bit back and a second chance, page 2 goes
+    "[3 0],[1 0],[2 0]",
+    "[3 0],[1 0],[4 0]",
+    "[3 0],[5 0],[4 0]",
+    "[3 0],[5 0],[4 0]",
+    "[3 0],[5 0],[6 0]"
+  };
+  const int requests[] = {0,1,2,3,1,4,5,3,6};
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  testName = "Testing CLOCK page replacement";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_CLOCK, NULL));
+
+  checkReferenceString(bm, requests, poolContents, 9);
+
+  // the hand is at frame 0 again: the pinned frame is stepped over
+  TEST_CHECK(pinPage(bm, h, 3));
+  pinAndUnpin(bm, 7);
+  ASSERT_EQUALS_POOL("[3 1],[7 0],[6 0]", bm, "pinned frame is not evicted");
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(h);
+  free(bm);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLFU (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    // page 0 is pinned three times, page 1 twice
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages pinned once go first
+    "[0 0],[1 0],[3 0]",
+    "[0 0],[1 0],[4 0]",
+    // of pages 1 and 4, both pinned twice, page 1 got there first
+    "[0 0],[1 0],[4 0]",
+    "[0 0],[5 0],[4 0]",
+    "[0 0],[6 0],[4 0]"
+  };
+  const int requests[] = {0,1,2,0,0,1,3,4,4,5,6};
+  const char *agedContents[] = {
+    "[0 0],[-1 0]",
+    "[0 0],[-1 0]",
+    "[0 0],[-1 0]",
+    // the fourth pin halves the counts: page 0 is back at 1
+    "[0 0],[1 0]",
+    "[0 0],[1 0]",
+    "[2 0],[1 0]"
+  };
+  const int agedRequests[] = {0,0,0,1,1,2};
+  int agingInterval = 4;
+  BM_BufferPool *bm = MAKE_POOL();
+
+  testName = "Testing LFU page replacement";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+  checkReferenceString(bm, requests, poolContents, 11);
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // with aging, pins long ago stop counting
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LFU, &agingInterval));
+  checkReferenceString(bm, agedRequests, agedContents, 6);
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLRU_2 (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages 0 and 1 are referenced twice
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages referenced once go first: page 3 goes, although page 0 was used longer ago
+    "[0 0],[1 0],[3 0]",
+    "[0 0],[1 0],[4 0]",
+    // page 2 comes back with its earlier reference from the history: two references, so page 4 goes
+    "[0 0],[1 0],[2 0]",
+    // page 0 has the oldest second to last reference
+    "[5 0],[1 0],[2 0]"
+  };
+  const int requests[] = {0,1,2,0,1,3,4,2,5};
+  const char *correlatedContents[] = {
+    "[0 0],[-1 0]",
+    "[0 0],[1 0]",
+    "[0 0],[1 0]",
+    "[0 0],[1 0]",
+    // the two pins of page 1 in a row are one reference: page 1 goes, not page 0
+    "[0 0],[2 0]"
+  };
+  const int correlatedRequests[] = {0,1,1,0,2};
+  BM_LRUKOptions options = { .k = 2 };
+  BM_BufferPool *bm = MAKE_POOL();
+
+  testName = "Testing LRU-2 page replacement";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &options));
+  checkReferenceString(bm, requests, poolContents, 9);
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // without a correlated reference period page 1 has two references and page 0 goes
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LRU_K, &options));
+  checkReferenceString(bm, correlatedRequests, correlatedContents, 4);
+  pinAndUnpin(bm, 2);
+  ASSERT_EQUALS_POOL("[2 0],[1 0]", bm, "uncorrelated pins are two references");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  options.correlatedPeriod = 1;
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LRU_K, &options));
+  checkReferenceString(bm, correlatedRequests, correlatedContents, 5);
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPinnedListFrames (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *other = MAKE_PAGE_HANDLE();
+  const int requests[] = {0,1,2};
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]"
+  };
+
+  testName = "Testing FIFO and LRU with pinned pages";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+
+  // FIFO: pinning does not change the load order, the pinned oldest page is stepped over
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  checkReferenceString(bm, requests, poolContents, 3);
+  TEST_CHECK(pinPage(bm, h, 0));
+  pinAndUnpin(bm, 3);
+  ASSERT_EQUALS_POOL("[0 1],[3 0],[2 0]", bm, "pinned oldest page stays");
+  TEST_CHECK(unpinPage(bm, h));
+  pinAndUnpin(bm, 4);
+  ASSERT_EQUALS_POOL("[4 0],[3 0],[2 0]", bm, "unpinned oldest page goes");
+  pinAndUnpin(bm, 5);
+  ASSERT_EQUALS_POOL("[4 0],[3 0],[5 0]", bm, "next page in load order goes");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // LRU: a page is used until its last pin is released
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  checkReferenceString(bm, requests, poolContents, 3);
+  TEST_CHECK(pinPage(bm, h, 0));
+  pinAndUnpin(bm, 1);
+  pinAndUnpin(bm, 3);
+  ASSERT_EQUALS_POOL("[0 1],[1 0],[3 0]", bm, "least recently used unpinned page goes");
+  TEST_CHECK(unpinPage(bm, h));
+  pinAndUnpin(bm, 4);
+  ASSERT_EQUALS_POOL("[0 0],[4 0],[3 0]", bm, "page unpinned last is the most recently used");
+  pinAndUnpin(bm, 5);
+  ASSERT_EQUALS_POOL("[0 0],[4 0],[5 0]", bm, "check pool content");
+
+  // two pins of page 0, one released: it still cannot go
+  TEST_CHECK(pinPage(bm, h, 0));
+  TEST_CHECK(pinPage(bm, other, 0));
+  TEST_CHECK(unpinPage(bm, other));
+  pinAndUnpin(bm, 6);
+  ASSERT_EQUALS_POOL("[0 1],[6 0],[5 0]", bm, "page with a pin left stays");
+  TEST_CHECK(unpinPage(bm, h));
+  pinAndUnpin(bm, 7);
+  ASSERT_EQUALS_POOL("[0 0],[6 0],[7 0]", bm, "check pool content");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(other);
+  free(h);
+  free(bm);
+
+  TEST_DONE();
+}